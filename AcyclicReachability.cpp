@@ -0,0 +1,130 @@
+//===-- AcyclicReachability.cpp - Reachability without back edges --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the AcyclicReachability function analysis.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "idenRegion"
+#include "AcyclicReachability.h"
+#include "llvm/Instructions.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+char AcyclicReachability::ID = 0;
+static RegisterPass<AcyclicReachability> X("idem-acyclic-reach",
+    "Reachability without back edges for idenRegion", true, true);
+
+void AcyclicReachability::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<DominatorTree>();
+    AU.setPreservesAll();
+}
+
+bool AcyclicReachability::runOnFunction(Function &F) {
+    releaseMemory();
+    F_ = &F;
+    DT_ = &getAnalysis<DominatorTree>();
+    return false;
+}
+
+void AcyclicReachability::releaseMemory() {
+    Built_ = false;
+    BlockIdx_.clear();
+    ComponentOf_.clear();
+    Reach_.clear();
+    Position_.clear();
+}
+
+void AcyclicReachability::build() {
+    Built_ = true;
+
+    // Number the blocks and instructions, and keep the forward edges.
+    std::vector<BasicBlock *> Blocks;
+    for (Function::iterator BB = F_->begin(), E = F_->end(); BB != E; ++BB) {
+        BlockIdx_[BB] = Blocks.size();
+        Blocks.push_back(BB);
+        unsigned Position = 0;
+        for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE;
+             ++I)
+            Position_[I] = Position++;
+    }
+    unsigned N = Blocks.size();
+    std::vector<unsigned> SuccStart(1, 0), Succs;
+    for (unsigned B = 0; B != N; ++B) {
+        TerminatorInst *TI = Blocks[B]->getTerminator();
+        for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i) {
+            BasicBlock *Succ = TI->getSuccessor(i);
+            if (!DT_->dominates(Succ, Blocks[B]))
+                Succs.push_back(BlockIdx_.lookup(Succ));
+        }
+        SuccStart.push_back(Succs.size());
+    }
+
+    // Tarjan's algorithm, without recursion.  A component is finished after
+    // every component it has an edge to, so their bitsets are complete when
+    // its own is filled in.
+    const unsigned Unvisited = ~0U;
+    std::vector<unsigned> Index(N, Unvisited), Low(N), Stack;
+    std::vector<bool> OnStack(N, false);
+    std::vector<std::pair<unsigned, unsigned> > Work;   // block, next edge
+    ComponentOf_.assign(N, 0);
+    Reach_.reserve(N);
+    unsigned NextIndex = 0;
+    for (unsigned Root = 0; Root != N; ++Root) {
+        if (Index[Root] != Unvisited)
+            continue;
+        Index[Root] = Low[Root] = NextIndex++;
+        Stack.push_back(Root);
+        OnStack[Root] = true;
+        Work.push_back(std::make_pair(Root, SuccStart[Root]));
+        while (!Work.empty()) {
+            unsigned B = Work.back().first;
+            if (Work.back().second != SuccStart[B + 1]) {
+                unsigned S = Succs[Work.back().second++];
+                if (Index[S] == Unvisited) {
+                    Index[S] = Low[S] = NextIndex++;
+                    Stack.push_back(S);
+                    OnStack[S] = true;
+                    Work.push_back(std::make_pair(S, SuccStart[S]));
+                } else if (OnStack[S]) {
+                    Low[B] = std::min(Low[B], Index[S]);
+                }
+                continue;
+            }
+            Work.pop_back();
+            if (!Work.empty())
+                Low[Work.back().first] =
+                    std::min(Low[Work.back().first], Low[B]);
+            if (Low[B] != Index[B])
+                continue;
+
+            // B roots a component: the blocks above it on the stack.
+            unsigned C = Reach_.size(), First = Stack.size();
+            do {
+                --First;
+                ComponentOf_[Stack[First]] = C;
+                OnStack[Stack[First]] = false;
+            } while (Stack[First] != B);
+            Reach_.push_back(BitVector(N));
+            BitVector &Reach = Reach_.back();
+            for (unsigned i = First, e = Stack.size(); i != e; ++i)
+                for (unsigned j = SuccStart[Stack[i]];
+                     j != SuccStart[Stack[i] + 1]; ++j) {
+                    unsigned S = Succs[j];
+                    Reach.set(S);
+                    if (ComponentOf_[S] != C)
+                        Reach |= Reach_[ComponentOf_[S]];
+                }
+            Stack.resize(First);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+//===-- AcyclicReachability.h - Reachability without back edges -*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a function analysis that answers "can control get from
+// instruction A to instruction B without taking a back edge?", where a back
+// edge is one to a block that dominates its source.  idenRegion-dynamic asks
+// it for every profiled (load, store) pair to check that the store follows
+// the load.
+//
+// The index is built on the first query of a function, so functions nobody
+// asks about cost nothing:
+//
+//   - the blocks reachable from each block through at least one forward edge,
+//     as one bitset per strongly connected component of the forward CFG
+//     (components are only nontrivial in irreducible code), filled in
+//     reverse topological order so each is the union of its successors'
+//   - the position of every instruction in its block
+//
+// after which every query is a bit test or a comparison of two positions.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_ACYCLICREACHABILITY_H
+#define IDENREGION_ACYCLICREACHABILITY_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instruction.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/Dominators.h"
+#include <vector>
+
+namespace llvm {
+
+class AcyclicReachability : public FunctionPass {
+ public:
+    static char ID; // Pass identification, replacement for typeid
+
+    AcyclicReachability() : FunctionPass(ID), F_(0), DT_(0), Built_(false) {}
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+    virtual bool runOnFunction(Function &F);
+    virtual void releaseMemory();
+
+    // Is To reached from From through at least one forward edge?  A block
+    // reaches itself only around an irreducible cycle.
+    bool isReachable(const BasicBlock *From, const BasicBlock *To) {
+        if (!Built_)
+            build();
+        return Reach_[ComponentOf_[BlockIdx_.lookup(From)]]
+            .test(BlockIdx_.lookup(To));
+    }
+
+    // Does To execute after From on some path without a back edge?  Both
+    // must be in the analyzed function.
+    bool isReachable(const Instruction *From, const Instruction *To) {
+        if (!Built_)
+            build();
+        if (From->getParent() == To->getParent() &&
+            Position_.lookup(From) < Position_.lookup(To))
+            return true;
+        return isReachable(From->getParent(), To->getParent());
+    }
+
+ private:
+    Function *F_;
+    DominatorTree *DT_;
+    bool Built_;
+
+    DenseMap<const BasicBlock *, unsigned> BlockIdx_;   // layout order
+    std::vector<unsigned> ComponentOf_;                 // by block index
+    std::vector<BitVector> Reach_;                      // by component
+    DenseMap<const Instruction *, unsigned> Position_;  // in its block
+
+    void build();
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,257 @@
+//===-------- AliasOracle.h - Memoized alias queries --------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a per-function alias oracle shared by the idenRegion
+// passes and idemcut.  The antidependence pair search asks "may this load read
+// what this store writes?" for every load on every reverse path of every
+// store, so the same question comes up again and again.  (Loads here include
+// memcpy/memmove reading their source and stores include every writer; see
+// MemoryAccess.h.)  The oracle answers it in tiers, cheapest first:
+//
+//   1. identical SSA pointer             -> may alias
+//   2. distinct identified objects       -> no alias
+//   3. same base, constant GEP offsets   -> overlap test on the byte ranges
+//   4. the full AliasAnalysis chain
+//
+// and memoizes every answer on (load pointer, store pointer, sizes, TBAA tag).
+//
+// Given FunctionSummaries, the oracle also answers the question for other
+// calls: a call reads what its callee's summary says it reads, and a call to
+// an idempotent callee writes what the summary says it writes.  Call answers
+// are memoized on the call itself.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_ALIASORACLE_H
+#define IDENREGION_ALIASORACLE_H
+
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/LLVMContext.h"
+#include "llvm/Metadata.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetData.h"
+#include "FunctionSummaries.h"
+#include "MemoryAccess.h"
+
+namespace llvm {
+
+class AliasOracle {
+ public:
+    // Tiers in the order they are tried.  Memo is the cache itself.
+    enum TierTy {
+        Memo = 0,
+        SamePointer,
+        DistinctObjects,
+        ConstantOffsets,
+        FullAA,
+        NumTiers
+    };
+
+    AliasOracle() : AA_(0), TD_(0), Summaries_(0) { clearCounters(); }
+
+    // Start a new function.  Cached answers do not carry over.  Without
+    // Summaries, calls are not considered readers at all.
+    void reset(AliasAnalysis *AA, const FunctionSummaries *Summaries = 0) {
+        AA_ = AA;
+        TD_ = AA->getTargetData();
+        Summaries_ = Summaries;
+        Cache_.clear();
+        CallCache_.clear();
+        WriterCache_.clear();
+        clearCounters();
+    }
+
+    const FunctionSummaries *getSummaries() const { return Summaries_; }
+
+    // Is I a call whose reads the pair search has to consider?  Memory
+    // intrinsics are plain readers and writers instead.
+    bool isReadingCall(const Instruction *I) const {
+        return Summaries_ && (isa<CallInst>(I) || isa<InvokeInst>(I)) &&
+               !isa<DbgInfoIntrinsic>(I) && !isa<MemIntrinsic>(I);
+    }
+
+    // Is I a call the pair search handles as a store?  See
+    // FunctionSummaries::isWritingCall().
+    bool isWritingCall(const Instruction *I) const {
+        return Summaries_ && Summaries_->isWritingCall(*I);
+    }
+
+    // Return true if Reader, a load, the source side of a memcpy/memmove or
+    // an isReadingCall() instruction, may read anything the isWritingCall()
+    // instruction Writer writes.
+    bool mayReadCall(Instruction *Reader, Instruction *Writer) {
+        WriterKey Key(Reader, Writer);
+        WriterCacheTy::iterator It = WriterCache_.find(Key);
+        if (It != WriterCache_.end()) {
+            ++Resolved_[Memo];
+            return It->second;
+        }
+        ++Missed_[Memo];
+
+        // Volatile and atomic loads conflict with everything, as in
+        // mayRead().
+        bool Answer = true;
+        Value *LoadPtr;
+        uint64_t LoadSize;
+        if (getReadAccess(Reader, TD_, LoadPtr, LoadSize))
+            Answer = Summaries_->callMayWrite(ImmutableCallSite(Writer),
+                                              LoadPtr, LoadSize);
+        else if (isReadingCall(Reader))
+            Answer = Summaries_->callMayReadCall(ImmutableCallSite(Reader),
+                                                 ImmutableCallSite(Writer));
+        Answer = resolve(FullAA, Answer);
+        WriterCache_[Key] = Answer;
+        return Answer;
+    }
+
+    // Return true if the call may read any of the StoreSize bytes at
+    // StorePtr.  Only valid for isReadingCall() instructions.
+    bool mayRead(ImmutableCallSite CS, Value *StorePtr, uint64_t StoreSize) {
+        CallKey Key(CS.getInstruction(), std::make_pair(StorePtr, StoreSize));
+        CallCacheTy::iterator It = CallCache_.find(Key);
+        if (It != CallCache_.end()) {
+            ++Resolved_[Memo];
+            return It->second;
+        }
+        ++Missed_[Memo];
+
+        bool Answer = resolve(FullAA,
+                              Summaries_->callMayRead(CS, StorePtr, StoreSize));
+        CallCache_[Key] = Answer;
+        return Answer;
+    }
+
+    // Return true if Reader, a load or the source side of a memcpy/memmove,
+    // may read any of the StoreSize bytes at StorePtr.
+    bool mayRead(Instruction *Reader, Value *StorePtr, uint64_t StoreSize) {
+        // Volatile and atomic accesses conflict with everything; AA says
+        // ModRef for them regardless of the pointer, so don't pollute the
+        // cache.
+        Value *LoadPtr;
+        uint64_t LoadSize;
+        if (!getReadAccess(Reader, TD_, LoadPtr, LoadSize))
+            return true;
+
+        LoadInst *Load = dyn_cast<LoadInst>(Reader);
+        MDNode *Tag = Load ? Load->getMetadata(LLVMContext::MD_tbaa) : 0;
+        QueryKey Key(std::make_pair(LoadPtr, StorePtr),
+                     std::make_pair(Tag, std::make_pair(LoadSize, StoreSize)));
+
+        CacheTy::iterator It = Cache_.find(Key);
+        if (It != Cache_.end()) {
+            ++Resolved_[Memo];
+            return It->second;
+        }
+        ++Missed_[Memo];
+
+        bool Answer = answer(Load, LoadPtr, LoadSize, StorePtr, StoreSize);
+        Cache_[Key] = Answer;
+        return Answer;
+    }
+
+    // Number of queries resolved (or passed on) by a given tier.
+    unsigned getResolved(TierTy T) const { return Resolved_[T]; }
+    unsigned getMissed(TierTy T)   const { return Missed_[T]; }
+
+    // Debugging support: one line per tier.
+    void print(raw_ostream &OS) const {
+        static const char *const Names[NumTiers] = {
+            "memo", "same-pointer", "distinct-objects", "constant-offsets",
+            "full-aa"
+        };
+        OS << "Alias oracle: "
+           << Cache_.size() + CallCache_.size() + WriterCache_.size()
+           << " cached answers\n";
+        for (unsigned T = 0; T != NumTiers; ++T)
+            OS << "  " << Names[T] << ": " << Resolved_[T] << " hit, "
+               << Missed_[T] << " miss\n";
+    }
+
+ private:
+    typedef std::pair<std::pair<const Value *, const Value *>,
+                      std::pair<const MDNode *,
+                                std::pair<uint64_t, uint64_t> > > QueryKey;
+    typedef DenseMap<QueryKey, bool> CacheTy;
+    typedef std::pair<const Value *, std::pair<const Value *, uint64_t> >
+        CallKey;
+    typedef DenseMap<CallKey, bool> CallCacheTy;
+    typedef std::pair<const Value *, const Value *> WriterKey;
+    typedef DenseMap<WriterKey, bool> WriterCacheTy;
+
+    AliasAnalysis *AA_;
+    const TargetData *TD_;   // may be null; disables the offset tier
+    const FunctionSummaries *Summaries_;
+    CacheTy Cache_;
+    CallCacheTy CallCache_;
+    WriterCacheTy WriterCache_;      // (reader, writing call)
+    unsigned Resolved_[NumTiers];
+    unsigned Missed_[NumTiers];
+
+    void clearCounters() {
+        for (unsigned T = 0; T != NumTiers; ++T)
+            Resolved_[T] = Missed_[T] = 0;
+    }
+
+    bool resolve(TierTy T, bool Answer) {
+        ++Resolved_[T];
+        return Answer;
+    }
+
+    // Load is null for a memcpy/memmove source.
+    bool answer(LoadInst *Load, Value *LoadPtr, uint64_t LoadSize,
+                Value *StorePtr, uint64_t StoreSize) {
+        // Tier 1: the very same address.
+        if (LoadPtr->stripPointerCasts() == StorePtr->stripPointerCasts())
+            return resolve(SamePointer, true);
+        ++Missed_[SamePointer];
+
+        // Tier 2: two different allocas, globals or noalias calls.
+        Value *LoadObj = GetUnderlyingObject(LoadPtr, TD_);
+        Value *StoreObj = GetUnderlyingObject(StorePtr, TD_);
+        if (LoadObj != StoreObj &&
+            isIdentifiedObject(LoadObj) && isIdentifiedObject(StoreObj))
+            return resolve(DistinctObjects, false);
+        ++Missed_[DistinctObjects];
+
+        // Tier 3: constant offsets off a common base; compare byte ranges.
+        if (TD_) {
+            int64_t LoadOff = 0, StoreOff = 0;
+            Value *LoadBase =
+                GetPointerBaseWithConstantOffset(LoadPtr, LoadOff, *TD_);
+            Value *StoreBase =
+                GetPointerBaseWithConstantOffset(StorePtr, StoreOff, *TD_);
+            if (LoadBase == StoreBase) {
+                bool Overlap =
+                    (StoreSize == AliasAnalysis::UnknownSize ||
+                     LoadOff < StoreOff + (int64_t)StoreSize) &&
+                    (LoadSize == AliasAnalysis::UnknownSize ||
+                     StoreOff < LoadOff + (int64_t)LoadSize);
+                return resolve(ConstantOffsets, Overlap);
+            }
+        }
+        ++Missed_[ConstantOffsets];
+
+        // Tier 4: ask the whole AA chain.
+        if (!Load)
+            return resolve(FullAA, AA_->alias(LoadPtr, LoadSize, StorePtr,
+                                              StoreSize) !=
+                                   AliasAnalysis::NoAlias);
+        return resolve(FullAA, AA_->getModRefInfo(Load, StorePtr, StoreSize) &
+                               AliasAnalysis::Ref);
+    }
+};
+
+} // End llvm namespace
+
+#endif
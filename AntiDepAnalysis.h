@@ -0,0 +1,331 @@
+//===-------- AntiDepAnalysis.h - Paths and hitting set -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the path and hitting set phases of the idenRegion
+// analysis as free functions over explicit inputs, so that drivers other than
+// the per-function passes (e.g. idenRegion-module) can run them.  Neither
+// phase writes to the IR or to any analysis; everything they produce goes
+// into caller-owned containers.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_ANTIDEPANALYSIS_H
+#define IDENREGION_ANTIDEPANALYSIS_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/ProfileInfo.h"
+#include "BitsetHittingSet.h"
+#include "DomPathIndex.h"
+#include "ExactHittingSet.h"
+#include "GreedyHittingSet.h"
+#include "HittingSet.h"
+#include "IdemOptions.h"
+#include "IdemProfile.h"
+#include "MemoryAccess.h"
+#include "PathReduction.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+typedef std::pair<Instruction *, Instruction *> AntiDepPairTy;
+typedef SmallVector<Instruction *, 16> AntiDepPathTy;
+typedef SmallVector<AntiDepPairTy, 16> AntiDepPairList;
+typedef SmallVector<AntiDepPathTy, 16> AntiDepPathList;
+typedef SmallPtrSet<Instruction *, 16> AntiDepHittingSet;
+
+// For every pair, record the store plus every writer (store or memory
+// intrinsic) on the dominator chain between the load and the store.  The
+// paths are found as intervals of Index (see DomPathIndex.h); with Reduction,
+// duplicate and subsumed paths are dropped on the intervals and only the
+// rest are written out.  Any hitting set of those hits the dropped ones too.
+// PairOf, if given, gets the index in Pairs of the pair of each path written.
+inline void computeAntiDepPaths(const DomPathIndex &Index,
+                                ArrayRef<AntiDepPairTy> Pairs,
+                                AntiDepPathList &Paths,
+                                PathReductionStats *Reduction = 0,
+                                std::vector<unsigned> *PairOf = 0) {
+    std::vector<DomPathIndex::DomPath> DomPaths;
+    DomPaths.reserve(Pairs.size());
+    for (unsigned i = 0, e = Pairs.size(); i != e; ++i)
+        DomPaths.push_back(Index.getPath(Pairs[i].first, Pairs[i].second));
+
+    std::vector<char> Keep(DomPaths.size(), 1);
+    if (Reduction)
+        Index.reduce(DomPaths, Keep, *Reduction);
+    for (unsigned i = 0, e = DomPaths.size(); i != e; ++i)
+        if (Keep[i]) {
+            Paths.resize(Paths.size() + 1);
+            Index.expand(DomPaths[i], Paths.back());
+            if (PairOf)
+                PairOf->push_back(i);
+        }
+}
+
+// Run hitting set engine SolverT over paths of candidate ids.
+template <typename SolverT>
+inline void solveHittingSet(unsigned NumCandidates,
+                            const std::vector<std::vector<unsigned> > &Paths,
+                            std::vector<unsigned> &Picks) {
+    SolverT Solver(NumCandidates);
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        Solver.addPath(Paths[i].begin(), Paths[i].end());
+    Solver.solve(Picks);
+}
+
+// The same through the CSR library of hittingSet.cpp, in one arena.
+inline void
+solveArenaHittingSet(unsigned NumCandidates,
+                     const std::vector<std::vector<unsigned> > &Paths,
+                     std::vector<unsigned> &Picks) {
+    std::vector<unsigned> Start(1, 0), Nodes;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+        Nodes.insert(Nodes.end(), Paths[i].begin(), Paths[i].end());
+        Start.push_back(Nodes.size());
+    }
+    if (Nodes.empty())
+        return;
+    SetCollection Sets = { NumCandidates, (unsigned)Paths.size(), &Start[0],
+                           &Nodes[0] };
+    std::vector<char> Mem(getHittingSetArenaSize(Sets));
+    HittingSetArena Arena(&Mem[0], Mem.size());
+    unsigned Base = Picks.size();
+    Picks.resize(Base + NumCandidates);
+    Picks.resize(Base + findHittingSet(Sets, Arena, &Picks[Base]));
+}
+
+// Give every writer on Paths a dense id, in order of first appearance, and
+// rewrite the paths in terms of the ids.
+inline void numberCandidates(const AntiDepPathList &Paths,
+                             std::vector<Instruction *> &Candidates,
+                             std::vector<std::vector<unsigned> > &IdPaths) {
+    DenseMap<Instruction *, unsigned> IdOf;
+    IdPaths.resize(Paths.size());
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        for (unsigned j = 0, je = Paths[i].size(); j != je; ++j) {
+            std::pair<DenseMap<Instruction *, unsigned>::iterator, bool> It =
+                IdOf.insert(std::make_pair(Paths[i][j], Candidates.size()));
+            if (It.second)
+                Candidates.push_back(Paths[i][j]);
+            IdPaths[i].push_back(It.first->second);
+        }
+}
+
+// Greedy hitting set: repeatedly take the writer on the most paths not hit
+// yet (see GreedyHittingSet.h).  Ties go to the writer that appears first in
+// Paths, so the result does not depend on where instructions are allocated.
+inline void computeGreedyHittingSet(const AntiDepPathList &Paths,
+                                    AntiDepHittingSet &HittingSet) {
+    std::vector<Instruction *> Candidates;
+    std::vector<std::vector<unsigned> > IdPaths;
+    numberCandidates(Paths, Candidates, IdPaths);
+
+    std::vector<unsigned> Picks;
+    if (HittingSetEngine == BitsetCover)
+        solveHittingSet<BitsetHittingSet>(Candidates.size(), IdPaths, Picks);
+    else if (HittingSetEngine == ArenaCover)
+        solveArenaHittingSet(Candidates.size(), IdPaths, Picks);
+    else
+        solveHittingSet<GreedyHittingSet>(Candidates.size(), IdPaths, Picks);
+    for (unsigned i = 0, e = Picks.size(); i != e; ++i)
+        HittingSet.insert(Candidates[Picks[i]]);
+}
+
+// How close computeExactHittingSet() got to a minimum.
+struct HittingSetBound {
+    unsigned Cuts;          // cuts chosen for the paths
+    unsigned Greedy;        // cuts the greedy heuristic chose
+    unsigned LowerBound;    // proved lower bound on the minimum
+    bool Optimal;           // Cuts is proved minimum
+
+    HittingSetBound() : Cuts(0), Greedy(0), LowerBound(0), Optimal(false) {}
+};
+
+// Minimum hitting set by branch and bound (see ExactHittingSet.h), within
+// -idem-exact-budget-ms; the greedy set if the search finds nothing better
+// in time.
+inline void computeExactHittingSet(const AntiDepPathList &Paths,
+                                   AntiDepHittingSet &HittingSet,
+                                   HittingSetBound &Bound) {
+    std::vector<Instruction *> Candidates;
+    std::vector<std::vector<unsigned> > IdPaths;
+    numberCandidates(Paths, Candidates, IdPaths);
+
+    ExactHittingSet Solver(Candidates.size());
+    for (unsigned i = 0, e = IdPaths.size(); i != e; ++i)
+        Solver.addPath(IdPaths[i].begin(), IdPaths[i].end());
+    std::vector<unsigned> Picks;
+    Bound.Optimal = Solver.solve(ExactBudgetMS, Picks);
+    Bound.Cuts = Picks.size();
+    Bound.Greedy = Solver.getGreedySize();
+    Bound.LowerBound = Solver.getLowerBound();
+    for (unsigned i = 0, e = Picks.size(); i != e; ++i)
+        HittingSet.insert(Candidates[Picks[i]]);
+}
+
+// Profiled execution counts of the blocks of a function, read on the main
+// thread (ProfileInfo caches as it answers).  Blocks without a count are 0.
+typedef DenseMap<const BasicBlock *, double> BlockCountMap;
+
+inline void getBlockCounts(ProfileInfo &PI, Function &F,
+                           BlockCountMap &Counts) {
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+        double Count = PI.getExecutionCount(BB);
+        Counts[BB] = Count == ProfileInfo::MissingValue ? 0 : Count;
+    }
+}
+
+// Block counts from a merged profile (-idem-profile-file), which keeps the
+// weighted counts that the llvmprof.out written for ProfileInfo rounds.  The
+// edges are in -insert-edge-profiling order: for every defined function the
+// entry edge, then the successor edges of each block.  A block counts the
+// edges into it.
+class MergedBlockCounts {
+ public:
+    bool loaded() const { return !FirstEdge_.empty(); }
+
+    // Map the profile at Path, which must have been taken of M.
+    bool load(const char *Path, Module &M, std::string &Error) {
+        FirstEdge_.clear();
+        if (!Profile_.map(Path, Error))
+            return false;
+        DenseMap<const Function *, unsigned> FirstEdge;
+        unsigned NumEdges = 0;
+        for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+            if (F->isDeclaration())
+                continue;
+            FirstEdge[F] = NumEdges++;
+            for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE;
+                 ++BB)
+                NumEdges += BB->getTerminator()->getNumSuccessors();
+        }
+        if (NumEdges != Profile_.getNumEdges()) {
+            Error = std::string(Path) + ": profile is not of this module";
+            return false;
+        }
+        FirstEdge_.swap(FirstEdge);
+        return true;
+    }
+
+    void getBlockCounts(Function &F, BlockCountMap &Counts) const {
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            Counts[BB] = 0;
+        unsigned Edge = FirstEdge_.lookup(&F);
+        Counts[&F.getEntryBlock()] += getCount(Edge++);
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+            TerminatorInst *TI = BB->getTerminator();
+            for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+                Counts[TI->getSuccessor(i)] += getCount(Edge++);
+        }
+    }
+
+ private:
+    IdemProfile Profile_;
+    DenseMap<const Function *, unsigned> FirstEdge_;
+
+    // Edges no run counted are 0, as with ProfileInfo.
+    double getCount(unsigned Edge) const {
+        double Count = Profile_.getEdgeCounts()[Edge];
+        return Count < 0 ? 0 : Count;
+    }
+};
+
+// The block counts of F, for the cut set cache key.  Printed in hex so that
+// counts that differ in any bit give different keys.
+inline std::string getBlockCountKey(Function &F, const BlockCountMap &Counts) {
+    std::string Key;
+    char Buf[32];
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+        snprintf(Buf, sizeof(Buf), "%a,", Counts.lookup(BB));
+        Key += Buf;
+    }
+    return Key;
+}
+
+// Cost of the path cuts, as computeCostWeightedHittingSet() charges it, with
+// and without the costs and weights.
+struct CutCostReport {
+    double Unweighted, Weighted;
+
+    CutCostReport() : Unweighted(0), Weighted(0) {}
+};
+
+// Weighted greedy hitting set: a cut costs CostOf(writer) (plus one, so
+// unprofiled code still prefers fewer cuts), path i weighs Weights[i] (1 if
+// Weights is empty), and the greedy takes the writer with the most unhit
+// path weight per cost.  With block counts as costs this minimizes the
+// dynamic region boundaries rather than the static cut count.
+template <typename CostFnT>
+inline void computeCostWeightedHittingSet(const AntiDepPathList &Paths,
+                                          ArrayRef<double> Weights,
+                                          const CostFnT &CostOf,
+                                          AntiDepHittingSet &HittingSet,
+                                          CutCostReport &Report) {
+    std::vector<Instruction *> Candidates;
+    std::vector<std::vector<unsigned> > IdPaths;
+    numberCandidates(Paths, Candidates, IdPaths);
+
+    std::vector<double> Cost(Candidates.size());
+    for (unsigned i = 0, e = Candidates.size(); i != e; ++i)
+        Cost[i] = CostOf(Candidates[i]);
+
+    GreedyHittingSet Unweighted(Candidates.size()), Weighted(Candidates.size());
+    for (unsigned i = 0, e = IdPaths.size(); i != e; ++i) {
+        Unweighted.addPath(IdPaths[i].begin(), IdPaths[i].end());
+        Weighted.addPath(IdPaths[i].begin(), IdPaths[i].end(),
+                         Weights.empty() ? 1.0 : Weights[i]);
+    }
+    for (unsigned i = 0, e = Candidates.size(); i != e; ++i)
+        Weighted.setCost(i, Cost[i] + 1);
+
+    std::vector<unsigned> Before, After;
+    Unweighted.solve(Before);
+    Weighted.solve(After);
+    for (unsigned i = 0, e = Before.size(); i != e; ++i)
+        Report.Unweighted += Cost[Before[i]];
+    for (unsigned i = 0, e = After.size(); i != e; ++i) {
+        Report.Weighted += Cost[After[i]];
+        HittingSet.insert(Candidates[After[i]]);
+    }
+}
+
+struct BlockCountCost {
+    const BlockCountMap &Counts;
+    explicit BlockCountCost(const BlockCountMap &C) : Counts(C) {}
+    double operator()(Instruction *I) const {
+        return Counts.lookup(I->getParent());
+    }
+};
+
+// The weighted hitting set by the profiled block counts.
+inline void computeWeightedHittingSet(const AntiDepPathList &Paths,
+                                      const BlockCountMap &Counts,
+                                      AntiDepHittingSet &HittingSet,
+                                      CutCostReport &Report) {
+    computeCostWeightedHittingSet(Paths, ArrayRef<double>(),
+                                  BlockCountCost(Counts), HittingSet, Report);
+}
+
+// Every cut costs the same, for path weights without block counts.
+struct UnitCost {
+    double operator()(Instruction *) const { return 1; }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,328 @@
+//===-------- AntiDepDataflow.h - Whole-function pair discovery ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file computes all memory antidependence pairs of a function with one
+// backward bitvector dataflow instead of one reverse DFS per store.
+//
+// Loads and stores are numbered densely; memcpy/memmove count as both, memset
+// as a store (see MemoryAccess.h).  The dataflow facts are the stores
+// whose backward search is still open at a program point: a store opens its
+// search at its own position, and a load closes the search of every store it
+// may read from, producing a (Load, Store) pair.  Per block this gives the
+// usual equations over store bitvectors
+//
+//   Out(B) = U In(S) for S in succ(B)
+//   In(B)  = Gen(B) | (Out(B) - Kill(B))
+//
+// where Kill(B) is every store read by some load in B and Gen(B) the stores
+// of B with no aliasing load above them.  After the fixpoint one more backward
+// sweep per block emits exactly the pairs the per-store DFS finds.
+//
+// With FunctionSummaries, reading calls take part like loads and writing calls
+// like stores, and every forced cut closes the search of all stores that
+// reach it: a cut after an instruction before it can read anything, a cut
+// before it afterwards.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_ANTIDEPDATAFLOW_H
+#define IDENREGION_ANTIDEPDATAFLOW_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Support/CFG.h"
+#include "llvm/Support/raw_ostream.h"
+#include "AliasOracle.h"
+#include "FunctionSummaries.h"
+#include "LoopDistance.h"
+#include "MemoryAccess.h"
+#include "MemoryBuckets.h"
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace llvm {
+
+class AntiDepDataflow {
+ public:
+    typedef std::pair<Instruction *, Instruction *> PairTy;
+
+    AntiDepDataflow(AliasOracle &Oracle, MemoryBuckets &Buckets,
+                    AliasAnalysis *AA, LoopDistance *Distance = 0)
+        : Oracle_(Oracle), Buckets_(Buckets), AA_(AA), Distance_(Distance) {}
+
+    // Find the antidependence pairs of every store in Stores and append them
+    // to Pairs, grouped by store in the order of Stores.
+    void run(Function &F, ArrayRef<Instruction *> Stores,
+             SmallVectorImpl<PairTy> &Pairs) {
+        prepare(F, Stores);
+        finish(Pairs);
+    }
+
+    // The two halves of run().  prepare() numbers everything and asks all the
+    // alias questions, so it is the only part that touches AA.  finish() is
+    // pure bitvector work on state owned by this object and may run on
+    // another thread.
+    void prepare(Function &F, ArrayRef<Instruction *> Stores) {
+        Stores_.assign(Stores.begin(), Stores.end());
+        if (Stores_.empty())
+            return;
+        numberStores();
+        numberBlocks(F);
+    }
+
+    void finish(SmallVectorImpl<PairTy> &Pairs) {
+        if (Stores_.empty())
+            return;
+        solve();
+        emit(Pairs);
+    }
+
+ private:
+    AliasOracle &Oracle_;
+    MemoryBuckets &Buckets_;
+    AliasAnalysis *AA_;
+    LoopDistance *Distance_;    // optional loop disambiguation
+
+    // Dense store numbering, and the store numbers in each memory bucket.
+    // A writing call has a null pointer and the Unknown bucket.
+    std::vector<Instruction *> Stores_;
+    DenseMap<const Instruction *, unsigned> StoreIdx_;
+    std::vector<Value *> StorePtr_;
+    std::vector<uint64_t> StoreSize_;
+    std::vector<SmallVector<unsigned, 8> > StoresIn_;
+
+    // Dense numbering of loads and reading calls; Reads_[L] holds the
+    // stores reader L may read.
+    DenseMap<const Instruction *, unsigned> LoadIdx_;
+    std::vector<BitVector> Reads_;
+
+    // Cuts FunctionSummaries forces around an instruction, recorded by
+    // prepare() so that finish() needs no summaries.
+    DenseMap<const Instruction *, unsigned> Forced_;
+
+    // Per-block dataflow state, indexed in function order.
+    DenseMap<const BasicBlock *, unsigned> BlockIdx_;
+    std::vector<BasicBlock *> Blocks_;
+    std::vector<BitVector> Gen_, Kill_, In_, Out_;
+
+    void numberStores() {
+        StoresIn_.resize(Buckets_.getNumBuckets());
+        for (unsigned i = 0, e = Stores_.size(); i != e; ++i) {
+            Instruction *Store = Stores_[i];
+            Value *Ptr = 0;
+            uint64_t Size = 0;
+            getWriteAccess(Store, AA_->getTargetData(), Ptr, Size);
+            StoreIdx_[Store] = i;
+            StorePtr_.push_back(Ptr);
+            StoreSize_.push_back(Size);
+            StoresIn_[Ptr ? Buckets_.getBucket(Ptr)
+                          : (unsigned)MemoryBuckets::Unknown].push_back(i);
+        }
+    }
+
+    // May reader Load, a load or a reading call, read what store s writes?
+    bool mayRead(Instruction *Load, unsigned s) {
+        if (!StorePtr_[s])
+            return Oracle_.mayReadCall(Load, Stores_[s]);
+        if (Oracle_.isReadingCall(Load))
+            return Oracle_.mayRead(ImmutableCallSite(Load), StorePtr_[s],
+                                   StoreSize_[s]);
+        return Oracle_.mayRead(Load, StorePtr_[s], StoreSize_[s]);
+    }
+
+    // Query the oracle for every store in bucket B.
+    void fillRow(Instruction *Load, unsigned B, BitVector &Row) {
+        const SmallVector<unsigned, 8> &InB = StoresIn_[B];
+        for (unsigned i = 0, e = InB.size(); i != e; ++i) {
+            unsigned s = InB[i];
+            if (mayRead(Load, s) &&
+                !(Distance_ && Distance_->isIndependent(Load, Stores_[s])))
+                Row.set(s);
+        }
+    }
+
+    // Number the loads and reading calls of BB and fill in their alias rows.
+    // Only stores in a compatible bucket are worth asking about; a call
+    // may read from any bucket.
+    void numberLoads(BasicBlock *BB) {
+        unsigned NumStores = StorePtr_.size();
+        for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E; ++I) {
+            if (Oracle_.isReadingCall(I)) {
+                LoadIdx_[I] = Reads_.size();
+                Reads_.push_back(BitVector(NumStores));
+                BitVector &Row = Reads_.back();
+                for (unsigned s = 0; s != NumStores; ++s)
+                    if (mayRead(I, s))
+                        Row.set(s);
+                continue;
+            }
+            if (!isa<LoadInst>(I) && !isMemoryReader(I))
+                continue;
+            Instruction *Load = I;
+            LoadIdx_[Load] = Reads_.size();
+            Reads_.push_back(BitVector(NumStores));
+            BitVector &Row = Reads_.back();
+            unsigned B = Buckets_.getReadBucket(Load);
+            if (B == MemoryBuckets::Unknown) {
+                for (unsigned b = 0, be = StoresIn_.size(); b != be; ++b)
+                    fillRow(Load, b, Row);
+            } else {
+                fillRow(Load, B, Row);
+                fillRow(Load, MemoryBuckets::Unknown, Row);
+            }
+        }
+    }
+
+    void numberBlocks(Function &F) {
+        unsigned NumStores = StorePtr_.size();
+        const FunctionSummaries *Summaries = Oracle_.getSummaries();
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+            BlockIdx_[BB] = Blocks_.size();
+            Blocks_.push_back(BB);
+            numberLoads(BB);
+
+            // Walk the block top-down: a store is exposed at block entry if
+            // no reader or forced cut above it closes its search.
+            BitVector Gen(NumStores), Kill(NumStores);
+            for (BasicBlock::iterator I = BB->begin(), E = BB->end();
+                 I != E; ++I) {
+                unsigned Forced = Summaries ? Summaries->getForcedCuts(*I)
+                                            : (unsigned)FunctionSummaries::NoCut;
+                if (Forced)
+                    Forced_[I] = Forced;
+                DenseMap<const Instruction *, unsigned>::iterator It =
+                    StoreIdx_.find(I);
+                if (It != StoreIdx_.end() && !Kill.test(It->second))
+                    Gen.set(It->second);
+                if (Forced)
+                    Kill.set();
+                else if (LoadIdx_.count(I))
+                    Kill |= Reads_[LoadIdx_[I]];
+            }
+            Gen_.push_back(Gen);
+            Kill_.push_back(Kill);
+            In_.push_back(Gen);
+            Out_.push_back(BitVector(NumStores));
+        }
+    }
+
+    // Iterate the backward equations to a fixpoint.
+    void solve() {
+        unsigned NumBlocks = Blocks_.size();
+        SmallVector<unsigned, 32> Worklist;
+        BitVector OnWorklist(NumBlocks, true);
+        for (unsigned b = 0; b != NumBlocks; ++b)
+            Worklist.push_back(b);
+
+        while (!Worklist.empty()) {
+            unsigned b = Worklist.pop_back_val();
+            OnWorklist.reset(b);
+            BasicBlock *BB = Blocks_[b];
+
+            BitVector &Out = Out_[b];
+            for (succ_iterator S = succ_begin(BB), E = succ_end(BB);
+                 S != E; ++S)
+                Out |= In_[BlockIdx_[*S]];
+
+            BitVector In = Kill_[b];
+            In.flip();
+            In &= Out;
+            In |= Gen_[b];
+            if (In == In_[b])
+                continue;
+            In_[b] = In;
+
+            for (pred_iterator P = pred_begin(BB), E = pred_end(BB);
+                 P != E; ++P) {
+                unsigned p = BlockIdx_[*P];
+                if (!OnWorklist.test(p)) {
+                    OnWorklist.set(p);
+                    Worklist.push_back(p);
+                }
+            }
+        }
+    }
+
+    // Replay every block bottom-up from its Out set and record the pairs.
+    void emit(SmallVectorImpl<PairTy> &Pairs) {
+        std::vector<SmallVector<Instruction *, 4> > LoadsOf(Stores_.size());
+        for (unsigned b = 0, e = Blocks_.size(); b != e; ++b) {
+            BasicBlock *BB = Blocks_[b];
+            BitVector Live = Out_[b];
+            for (BasicBlock::iterator I = BB->end(); I != BB->begin(); ) {
+                --I;
+                DenseMap<const Instruction *, unsigned>::iterator F =
+                    Forced_.find(I);
+                unsigned Forced = F == Forced_.end() ? 0 : F->second;
+                if (Forced & FunctionSummaries::CutAfter)
+                    Live.reset();
+                DenseMap<const Instruction *, unsigned>::iterator L =
+                    LoadIdx_.find(I), S = StoreIdx_.find(I);
+                if (L != LoadIdx_.end()) {
+                    BitVector Hit = Live;
+                    Hit &= Reads_[L->second];
+                    // A memmove or a call is not antidependent on itself
+                    if (S != StoreIdx_.end())
+                        Hit.reset(S->second);
+                    for (int s = Hit.find_first(); s != -1;
+                         s = Hit.find_next(s))
+                        LoadsOf[s].push_back(I);
+                    Live ^= Hit;
+                }
+                if (Forced & FunctionSummaries::CutBefore)
+                    Live.reset();
+                if (S != StoreIdx_.end())
+                    Live.set(S->second);
+            }
+        }
+
+        for (unsigned s = 0, e = Stores_.size(); s != e; ++s)
+            for (unsigned l = 0, le = LoadsOf[s].size(); l != le; ++l)
+                Pairs.push_back(PairTy(LoadsOf[s][l], Stores_[s]));
+    }
+};
+
+// Compare two pair lists as multisets and report the pairs found by only one
+// of them.  Returns true if they agree.
+inline bool checkAntiDepPairs(ArrayRef<AntiDepDataflow::PairTy> DFS,
+                              ArrayRef<AntiDepDataflow::PairTy> Dataflow,
+                              raw_ostream &OS) {
+    typedef AntiDepDataflow::PairTy PairTy;
+    std::vector<PairTy> A(DFS.begin(), DFS.end());
+    std::vector<PairTy> B(Dataflow.begin(), Dataflow.end());
+    std::sort(A.begin(), A.end());
+    std::sort(B.begin(), B.end());
+
+    std::vector<PairTy> OnlyA, OnlyB;
+    std::set_difference(A.begin(), A.end(), B.begin(), B.end(),
+                        std::back_inserter(OnlyA));
+    std::set_difference(B.begin(), B.end(), A.begin(), A.end(),
+                        std::back_inserter(OnlyB));
+    for (unsigned i = 0, e = OnlyA.size(); i != e; ++i)
+        OS << "Pair only in DFS:      " << *OnlyA[i].first << " -> "
+           << *OnlyA[i].second << "\n";
+    for (unsigned i = 0, e = OnlyB.size(); i != e; ++i)
+        OS << "Pair only in dataflow: " << *OnlyB[i].first << " -> "
+           << *OnlyB[i].second << "\n";
+    bool Agree = OnlyA.empty() && OnlyB.empty();
+    OS << "Pair engines " << (Agree ? "agree" : "DISAGREE") << " on "
+       << A.size() << " DFS pairs\n";
+    return Agree;
+}
+
+} // End llvm namespace
+
+#endif
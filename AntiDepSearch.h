@@ -0,0 +1,245 @@
+//===-------- AntiDepSearch.h - Grouped reverse pair search -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the reverse depth-first antidependence search of the
+// idenRegion passes, run for a whole group of stores at once.
+//
+// A store's search walks backward from the store and ends on every path at
+// the first reader that may read the stored bytes (or at a forced cut).  Stores
+// that write the same SSA pointer with the same size ask exactly the same
+// alias questions, so groupStores() buckets them by (pointer, size) and run()
+// walks each group once, carrying the set of group members whose search is
+// still open along the path.  A writing call (see FunctionSummaries) is a
+// group of its own.
+//
+//   - a member joins the walk at its own position
+//   - a reader closes the search of every open member it may read from,
+//     producing one pair per member (the loop distance test still decides
+//     per member)
+//   - a member's search that wraps around a loop back to the member itself
+//     is complete there
+//
+// Blocks are rescanned from the end only for members that have not reached
+// them before, so the result is exactly that of one search per store.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_ANTIDEPSEARCH_H
+#define IDENREGION_ANTIDEPSEARCH_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/PredIteratorCache.h"
+#include "llvm/Support/raw_ostream.h"
+#include "AliasOracle.h"
+#include "FunctionSummaries.h"
+#include "LoopDistance.h"
+#include "MemoryAccess.h"
+#include "MemoryBuckets.h"
+#include <vector>
+
+namespace llvm {
+
+class AntiDepSearch {
+ public:
+    typedef std::pair<Instruction *, Instruction *> PairTy;
+    typedef SmallVector<Instruction *, 4> GroupTy;
+
+    AntiDepSearch(AliasOracle &Oracle, MemoryBuckets &Buckets,
+                  AliasAnalysis *AA, PredIteratorCache &PredCache,
+                  LoopDistance *Distance = 0)
+        : Oracle_(Oracle), Buckets_(Buckets), AA_(AA), PredCache_(PredCache),
+          Distance_(Distance), NumStores_(0), NumGroups_(0) {}
+
+    // Split Stores into groups writing the same pointer and size, in order
+    // of first appearance.
+    void groupStores(ArrayRef<Instruction *> Stores,
+                     std::vector<GroupTy> &Groups) {
+        typedef std::pair<const Value *, uint64_t> KeyTy;
+        DenseMap<KeyTy, unsigned> GroupOf;
+        for (unsigned i = 0, e = Stores.size(); i != e; ++i) {
+            Value *Ptr;
+            uint64_t Size;
+            if (!getWriteAccess(Stores[i], AA_->getTargetData(), Ptr, Size)) {
+                Groups.push_back(GroupTy(1, Stores[i]));
+                continue;
+            }
+            std::pair<DenseMap<KeyTy, unsigned>::iterator, bool> It =
+                GroupOf.insert(std::make_pair(KeyTy(Ptr, Size), Groups.size()));
+            if (It.second)
+                Groups.resize(Groups.size() + 1);
+            Groups[It.first->second].push_back(Stores[i]);
+        }
+        NumStores_ += Stores.size();
+        NumGroups_ += Groups.size();
+    }
+
+    // Find the antidependence pairs of every store in Group and append them
+    // to Pairs, grouped by store in the order of Group.
+    void run(ArrayRef<Instruction *> Group, SmallVectorImpl<PairTy> &Pairs) {
+        unsigned N = Group.size();
+        if (getWriteAccess(Group[0], AA_->getTargetData(), Ptr_, Size_)) {
+            WritingCall_ = 0;
+            Bucket_ = Buckets_.getBucket(Ptr_);
+        } else {
+            WritingCall_ = Group[0];
+            Bucket_ = MemoryBuckets::Unknown;
+        }
+        Member_.clear();
+        MemberBlocks_.clear();
+        for (unsigned i = 0; i != N; ++i) {
+            Member_[Group[i]] = i;
+            MemberBlocks_.insert(Group[i]->getParent());
+        }
+        Group_ = Group;
+        LoadsOf_.assign(N, SmallVector<Instruction *, 4>());
+        Started_.clear();
+        Started_.resize(N);
+        Seen_.clear();
+
+        // Each member not picked up by an earlier walk starts its own.
+        for (unsigned i = 0; i != N; ++i) {
+            if (Started_.test(i))
+                continue;
+            Started_.set(i);
+            BitVector Live(N);
+            Live.set(i);
+            walk(Group[i]->getParent(), Group[i], Live);
+        }
+
+        for (unsigned i = 0; i != N; ++i)
+            for (unsigned l = 0, le = LoadsOf_[i].size(); l != le; ++l)
+                Pairs.push_back(PairTy(LoadsOf_[i][l], Group[i]));
+    }
+
+    void print(raw_ostream &OS) const {
+        OS << "Pair search: " << NumStores_ << " stores in " << NumGroups_
+           << " reverse searches\n";
+    }
+
+ private:
+    AliasOracle &Oracle_;
+    MemoryBuckets &Buckets_;
+    AliasAnalysis *AA_;
+    PredIteratorCache &PredCache_;
+    LoopDistance *Distance_;    // optional loop disambiguation
+    unsigned NumStores_, NumGroups_;
+
+    // State of the group being searched.
+    ArrayRef<Instruction *> Group_;
+    Value *Ptr_;
+    uint64_t Size_;
+    Instruction *WritingCall_;  // the group, if it is a writing call
+    unsigned Bucket_;
+    DenseMap<const Instruction *, unsigned> Member_;
+    SmallPtrSet<const BasicBlock *, 8> MemberBlocks_;
+    std::vector<SmallVector<Instruction *, 4> > LoadsOf_;
+    BitVector Started_;
+    DenseMap<const BasicBlock *, BitVector> Seen_;  // members scanned from end
+
+    struct WorkItem {
+        BasicBlock *BB;
+        BasicBlock::iterator I;
+        BitVector Live;
+        WorkItem(BasicBlock *B, BasicBlock::iterator It, const BitVector &L)
+            : BB(B), I(It), Live(L) {}
+    };
+
+    // May I read the bytes the group writes?
+    bool mayRead(Instruction *I) {
+        bool IsLoad = isa<LoadInst>(I) || isMemoryReader(I);
+        if (!IsLoad && !Oracle_.isReadingCall(I))
+            return false;
+        if (WritingCall_)
+            return Oracle_.mayReadCall(I, WritingCall_);
+        if (IsLoad)
+            return Buckets_.mayRead(I, Bucket_) &&
+                   Oracle_.mayRead(I, Ptr_, Size_);
+        return Oracle_.mayRead(ImmutableCallSite(I), Ptr_, Size_);
+    }
+
+    void walk(BasicBlock *StartBB, BasicBlock::iterator Start,
+              const BitVector &StartLive) {
+        const FunctionSummaries *Summaries = Oracle_.getSummaries();
+        SmallVector<WorkItem, 8> Worklist;
+        Worklist.push_back(WorkItem(StartBB, Start, StartLive));
+
+        do {
+            WorkItem W = Worklist.pop_back_val();
+            BasicBlock *BB = W.BB;
+            BitVector &Live = W.Live;
+            bool HasMembers = MemberBlocks_.count(BB);
+
+            // Blocks without a reader of a compatible bucket or a member
+            // cannot change the open set, so don't bother scanning them.
+            if (HasMembers || Buckets_.blockMayRead(BB, Bucket_)) {
+                BasicBlock::iterator I = W.I;
+                while (I != BB->begin() && (HasMembers || Live.any())) {
+                    --I;
+                    DenseMap<const Instruction *, unsigned>::iterator M =
+                        Member_.find(I);
+                    // Back at a member from below: its cycle is complete.
+                    if (M != Member_.end())
+                        Live.reset(M->second);
+
+                    unsigned Forced = FunctionSummaries::NoCut;
+                    if (Summaries)
+                        Forced = Summaries->getForcedCuts(*I);
+                    if (Forced & FunctionSummaries::CutAfter)
+                        Live.reset();
+                    if (Live.any() && mayRead(I)) {
+                        for (int m = Live.find_first(); m != -1;
+                             m = Live.find_next(m)) {
+                            if (Distance_ &&
+                                Distance_->isIndependent(I, Group_[m]))
+                                continue;
+                            LoadsOf_[m].push_back(I);
+                            Live.reset(m);
+                        }
+                    }
+                    if (Forced & FunctionSummaries::CutBefore)
+                        Live.reset();
+
+                    // A member reached before its own walk joins this one.
+                    if (M != Member_.end() && !Started_.test(M->second)) {
+                        Started_.set(M->second);
+                        Live.set(M->second);
+                    }
+                }
+            }
+            if (Live.none())
+                continue;
+
+            // Continue on to predecessors with the members new to them.
+            for (BasicBlock **P = PredCache_.GetPreds(BB); *P; ++P) {
+                BitVector &Seen = Seen_[*P];
+                if (Seen.empty())
+                    Seen.resize(Group_.size());
+                BitVector New = Seen;
+                New.flip();
+                New &= Live;
+                if (New.none())
+                    continue;
+                Seen |= New;
+                Worklist.push_back(WorkItem(*P, (*P)->end(), New));
+            }
+        } while (!Worklist.empty());
+    }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,176 @@
+//===-- BitsetHittingSet.cpp - Bitset greedy hitting set ------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of BitsetHittingSet and its popcount kernels.  The x86
+// kernels are compiled with per-function target attributes, so this file
+// needs no special flags and still runs on machines without AVX2.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BitsetHittingSet.h"
+#include <algorithm>
+#include <utility>
+
+// Target attributes and __builtin_cpu_supports: GCC 4.9 and clang 3.8.
+// clang claims to be GCC 4.2, so it is checked by its own version.
+#if defined(__clang__)
+#define IDEM_TARGET_ATTRIBUTES \
+    (__clang_major__ > 3 || (__clang_major__ == 3 && __clang_minor__ >= 8))
+#elif defined(__GNUC__)
+#define IDEM_TARGET_ATTRIBUTES \
+    (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#else
+#define IDEM_TARGET_ATTRIBUTES 0
+#endif
+
+#if IDEM_TARGET_ATTRIBUTES && (defined(__x86_64__) || defined(__i386__))
+#define IDEM_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace llvm;
+
+// Number of bits set in Bits[i] & Unhit[Idx[i]] over i < N.
+typedef uint64_t (*CountFnTy)(const uint32_t *Idx, const uint64_t *Bits,
+                              unsigned N, const uint64_t *Unhit);
+
+static inline unsigned popcount64(uint64_t V) {
+    V = V - ((V >> 1) & 0x5555555555555555ULL);
+    V = (V & 0x3333333333333333ULL) + ((V >> 2) & 0x3333333333333333ULL);
+    V = (V + (V >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+    return (V * 0x0101010101010101ULL) >> 56;
+}
+
+static uint64_t countPortable(const uint32_t *Idx, const uint64_t *Bits,
+                              unsigned N, const uint64_t *Unhit) {
+    uint64_t Count = 0;
+    for (unsigned i = 0; i != N; ++i)
+        Count += popcount64(Bits[i] & Unhit[Idx[i]]);
+    return Count;
+}
+
+#ifdef IDEM_X86_KERNELS
+__attribute__((target("popcnt")))
+static uint64_t countPopcnt(const uint32_t *Idx, const uint64_t *Bits,
+                            unsigned N, const uint64_t *Unhit) {
+    uint64_t Count = 0;
+    for (unsigned i = 0; i != N; ++i)
+        Count += __builtin_popcountll(Bits[i] & Unhit[Idx[i]]);
+    return Count;
+}
+
+// Four words at a time: gather the mask words, AND, and count the bits of
+// every nibble with a shuffle table, summing bytes with SAD.
+__attribute__((target("avx2")))
+static uint64_t countAVX2(const uint32_t *Idx, const uint64_t *Bits,
+                          unsigned N, const uint64_t *Unhit) {
+    const __m256i Table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3,
+                                           1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3,
+                                           1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i Nibble = _mm256_set1_epi8(0x0F);
+    const __m256i Zero = _mm256_setzero_si256();
+    __m256i Acc = Zero;
+    unsigned i = 0;
+    for (; i + 4 <= N; i += 4) {
+        __m128i W = _mm_loadu_si128((const __m128i *)(Idx + i));
+        __m256i U = _mm256_i32gather_epi64((const long long *)Unhit, W, 8);
+        __m256i B = _mm256_loadu_si256((const __m256i *)(Bits + i));
+        __m256i V = _mm256_and_si256(U, B);
+        __m256i Lo = _mm256_shuffle_epi8(Table, _mm256_and_si256(V, Nibble));
+        __m256i Hi = _mm256_shuffle_epi8(
+            Table, _mm256_and_si256(_mm256_srli_epi16(V, 4), Nibble));
+        Acc = _mm256_add_epi64(Acc,
+                               _mm256_sad_epu8(_mm256_add_epi8(Lo, Hi), Zero));
+    }
+    uint64_t Lanes[4];
+    _mm256_storeu_si256((__m256i *)Lanes, Acc);
+    uint64_t Count = Lanes[0] + Lanes[1] + Lanes[2] + Lanes[3];
+    for (; i != N; ++i)
+        Count += __builtin_popcountll(Bits[i] & Unhit[Idx[i]]);
+    return Count;
+}
+#endif
+
+namespace {
+struct Kernel {
+    CountFnTy Count;
+    const char *Name;
+
+    Kernel() : Count(countPortable), Name("portable") {
+#ifdef IDEM_X86_KERNELS
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            Count = countAVX2;
+            Name = "avx2";
+        } else if (__builtin_cpu_supports("popcnt")) {
+            Count = countPopcnt;
+            Name = "popcnt";
+        }
+#endif
+    }
+};
+}
+
+static const Kernel TheKernel;
+
+const char *BitsetHittingSet::getKernelName() {
+    return TheKernel.Name;
+}
+
+namespace {
+// Heap entry: a candidate and a score that may be stale (too high).
+typedef std::pair<uint64_t, unsigned> EntryTy;
+
+// Heap order, worst on top for std::push_heap: fewer paths first, then the
+// larger id.  Agrees with GreedyHittingSet on ties.
+struct WorseEntry {
+    bool operator()(const EntryTy &A, const EntryTy &B) const {
+        if (A.first != B.first)
+            return A.first < B.first;
+        return A.second > B.second;
+    }
+};
+}
+
+void BitsetHittingSet::solve(std::vector<unsigned> &Picks) {
+    std::vector<uint64_t> Unhit((NumPaths_ + 63) / 64, ~uint64_t(0));
+
+    WorseEntry Worse;
+    std::vector<EntryTy> Heap;
+    for (unsigned C = 0, e = Rows_.size(); C != e; ++C)
+        if (!Rows_[C].Idx.empty())
+            Heap.push_back(EntryTy(TheKernel.Count(&Rows_[C].Idx[0],
+                                                   &Rows_[C].Bits[0],
+                                                   Rows_[C].Idx.size(),
+                                                   &Unhit[0]), C));
+    std::make_heap(Heap.begin(), Heap.end(), Worse);
+
+    while (!Heap.empty()) {
+        std::pop_heap(Heap.begin(), Heap.end(), Worse);
+        EntryTy Top = Heap.back();
+        Heap.pop_back();
+
+        const RowTy &Row = Rows_[Top.second];
+        Top.first = TheKernel.Count(&Row.Idx[0], &Row.Bits[0], Row.Idx.size(),
+                                    &Unhit[0]);
+        if (Top.first == 0)
+            continue;
+        // Rescored below the next stale entry: try again later.
+        if (!Heap.empty() && Worse(Top, Heap.front())) {
+            Heap.push_back(Top);
+            std::push_heap(Heap.begin(), Heap.end(), Worse);
+            continue;
+        }
+
+        Picks.push_back(Top.second);
+        for (unsigned i = 0, e = Row.Idx.size(); i != e; ++i)
+            Unhit[Row.Idx[i]] &= ~Row.Bits[i];
+    }
+}
@@ -0,0 +1,70 @@
+//===------- BitsetHittingSet.h - Bitset greedy hitting set -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a second engine for the greedy hitting set of
+// GreedyHittingSet.h, built for functions with very many paths.  Each
+// candidate is a bit row over path indices (all-zero words left out), and the
+// paths no pick hits yet are a dense "unhit" mask.  A candidate's score is
+// popcount(row & unhit), computed by a kernel chosen at run time: AVX2 with
+// a gather of the mask words, the POPCNT instruction, or portable code.
+//
+// Scores only go down as picks are made, so the engine is a lazy greedy: the
+// heap holds possibly stale scores, and only the candidate on top is
+// rescored.  If it still beats the next stale score it beats every true one,
+// so the picks are exactly those of GreedyHittingSet, ties included.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_BITSETHITTINGSET_H
+#define IDENREGION_BITSETHITTINGSET_H
+
+#include <stdint.h>
+#include <vector>
+
+namespace llvm {
+
+class BitsetHittingSet {
+ public:
+    explicit BitsetHittingSet(unsigned NumCandidates)
+        : Rows_(NumCandidates), NumPaths_(0) {}
+
+    // Add a path through the candidates [Begin, End).
+    template <typename IterT>
+    void addPath(IterT Begin, IterT End) {
+        unsigned P = NumPaths_++;
+        uint32_t Word = P / 64;
+        uint64_t Bit = uint64_t(1) << (P % 64);
+        for (; Begin != End; ++Begin) {
+            RowTy &Row = Rows_[*Begin];
+            if (Row.Idx.empty() || Row.Idx.back() != Word) {
+                Row.Idx.push_back(Word);
+                Row.Bits.push_back(0);
+            }
+            Row.Bits.back() |= Bit;
+        }
+    }
+
+    // Append the chosen candidates to Picks, in the order they are taken.
+    void solve(std::vector<unsigned> &Picks);
+
+    // The popcount kernel solve() runs on this machine.
+    static const char *getKernelName();
+
+ private:
+    struct RowTy {
+        std::vector<uint32_t> Idx;      // word index into the unhit mask
+        std::vector<uint64_t> Bits;     // the row's bits in that word
+    };
+    std::vector<RowTy> Rows_;
+    unsigned NumPaths_;
+};
+
+} // End llvm namespace
+
+#endif
@@ -28,6 +28,11 @@
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/raw_os_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "AliasOracle.h"
+#include "MemoryBuckets.h"
+#include "PriorityHittingSet.h"
 
 using namespace std;
 using namespace llvm;
@@ -37,6 +42,10 @@ static std::ofstream stat_file;
 
 static int function = 0;
 
+static cl::opt<bool> LoopDepthCuts("idemcut-loop-priority",
+    cl::desc("Rank idemcut cut candidates by loop depth before path count"),
+    cl::init(false));
+
 namespace
 {
     struct CUT : public FunctionPass
@@ -49,6 +58,8 @@ namespace
         LoopInfo      *LI;              // Current LoopInfo
         DominatorTree *DT;              // Dominator Tree for the current Loop.
         PredIteratorCache PredCache_;   // Cache fetch predecessor of a BB
+        AliasOracle Oracle_;            // Memoized load/store alias queries
+        MemoryBuckets Buckets_;         // Loads/stores grouped by underlying object
         //LAMPLoadProfile *LLP;           // LAMP profiling
 
         //added from Haokun's project
@@ -81,7 +92,6 @@ namespace
         void computeHittingSet();
         // return a set of BB that need cut
         std::set<BasicBlock *> computeHittingSetinBB();
-        Instruction* findLargestCount(std::map<Instruction *, int> Map);
 
         CUT() : FunctionPass(ID) {}
         void getAnalysisUsage(AnalysisUsage &AU) const
@@ -356,6 +366,8 @@ bool CUT::startHitting(Function &F)
     LI = &getAnalysis<LoopInfo>();
     AA = &getAnalysis<AliasAnalysis>();
     DT = &getAnalysis<DominatorTree>();
+    Oracle_.reset(AA);
+    Buckets_.build(F, AA->getTargetData());
     
     for (Function::iterator BB = F.begin(); BB != F.end(); ++BB) {
         for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ++I) {
@@ -364,7 +376,14 @@ bool CUT::startHitting(Function &F)
             }
         }
     }
-    
+
+    // record how the alias queries were answered
+    {
+        raw_os_ostream StatOS(stat_file);
+        Oracle_.print(StatOS);
+        Buckets_.print(StatOS);
+    }
+
     if (AntiDepPairs_.empty())
         return false;
         
@@ -381,6 +400,7 @@ void CUT::findAntidependencePairs(StoreInst *Store)
     // Value *First = Store->getOperand(0); // src
     // errs() << "Store src type is " << *(First->getType()) << "\n";
     unsigned StoreDstSize = AA->getTypeStoreSize(Store->getOperand(0)->getType());
+    unsigned StoreBucket = Buckets_.getBucket(StoreDst);
 
     // Perform a reverse depth-first search to find aliasing loads.
     typedef std::pair<BasicBlock *, BasicBlock::iterator> WorkItem;
@@ -400,13 +420,15 @@ void CUT::findAntidependencePairs(StoreInst *Store)
         E = (BB == StoreBB && I == BB->end()) ? Store : BB->begin();
         
         // Scan for an aliasing load.  Terminate this path if we see one or a cut is
-        // already forced.
-        if (scanForAliasingLoad(I, E, Store, StoreDst, StoreDstSize))
+        // already forced.  Blocks without a load from a compatible bucket
+        // cannot terminate it, so don't bother scanning them.
+        if (Buckets_.blockMayRead(BB, StoreBucket) &&
+            scanForAliasingLoad(I, E, Store, StoreDst, StoreDstSize))
             continue;
             
         // If the path didn't terminate, continue on to predecessors.
         // errs() << "###### Predecessor Info #######" << "\n";
-        for (BasicBlock **P = PredCache_.GetPreds(StoreBB); *P; ++P) {
+        for (BasicBlock **P = PredCache_.GetPreds(BB); *P; ++P) {
             //errs() << "## Name is " << (*P)->getName() << "\n";
             if (Visited.insert(*P))
                 Worklist.push_back(WorkItem((*P), (*P)->end()));
@@ -421,11 +443,15 @@ bool CUT::scanForAliasingLoad (BasicBlock::iterator I,
                                       unsigned StoreDstSize)
 {
     // I is the end of the instruction, E is the begining of the instruction
+    unsigned StoreBucket = Buckets_.getBucket(StoreDst);
     while (I != E) {
         --I;
         if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+            // Loads of a different object can't be antidependent
+            if (!Buckets_.mayRead(Load, StoreBucket))
+                continue;
             // Load all the may alias case
-            if (AA->getModRefInfo(Load, StoreDst, StoreDstSize) & AliasAnalysis::Ref) {
+            if (Oracle_.mayRead(Load, StoreDst, StoreDstSize)) {
                 AntiDepPairTy Pair = AntiDepPairTy(I, Store);
                 AntiDepPairs_.push_back(Pair);
                 return true;
@@ -488,55 +514,13 @@ void CUT::computeAntidependencePaths() {
     }
 }
 
-Instruction* CUT::findLargestCount(std::map<Instruction *, int> Map) {
-    // TODO: linear right now, optimize later
-    Instruction* temp_max;
-    int max = 0;
-    for (std::map<Instruction *, int>::iterator I = Map.begin(), E = Map.end(); I != E; I++) {
-        // exclude those in the hitting set
-        if (I->second > max) {
-            temp_max = I->first;
-            max = I->second;
-        }
-    }
-    return temp_max;
-}
-
 void CUT::computeHittingSet() {
-    std::vector<AntiDepPathTy> collectionPaths;
-    typedef std::map<Instruction *, int> instCountTy;
-    typedef std::map<Instruction *, std::set<int> > instPosTy; 
-    instCountTy instCount;
-    instPosTy instPos;
-    int index = 0;
-    for (AntiDepPaths::iterator I = AntiDepPaths_.begin(), E = AntiDepPaths_.end(); I != E; I++, index++) {
-        collectionPaths.push_back(*I);
-        // construct the map
-        for (AntiDepPathTy::iterator II = I->begin(), EE = I->end(); II != EE; II++) {
-            instCount[*II] += 1;
-            instPos[*II].insert(index);
-        }
-    }
-    
-    // Generate the Hitting set based on Map information
-    int totalPaths = collectionPaths.size();
-    std::set<int> HittedSet;
-    while ((int)HittedSet.size() < totalPaths) {
-        bool increase = false;
-        int oldLen = HittedSet.size();
-        while (!increase) {
-            Instruction* maxCountInst = findLargestCount(instCount);
-            std::set<int> tempPos = instPos[maxCountInst];
-            for (std::set<int>::iterator I = tempPos.begin(), E = tempPos.end(); I != E; I++) {
-                HittedSet.insert(*I);
-            }
-            instCount.erase(maxCountInst);
-            if ((int)HittedSet.size() > oldLen) {
-                increase = true;
-                HittingSet_.insert(maxCountInst);
-            }
-        }
-    }
+    if (LoopDepthCuts)
+        computePriorityHittingSet(AntiDepPaths_, LI->getBase(),
+                                  LoopDepthPriority(), HittingSet_);
+    else
+        computePriorityHittingSet(AntiDepPaths_, LI->getBase(),
+                                  PathCountPriority(), HittingSet_);
 }
 
 std::set<BasicBlock *> CUT::computeHittingSetinBB() {
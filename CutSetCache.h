@@ -0,0 +1,308 @@
+//===-------- CutSetCache.h - On-disk cache of per-function cuts --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a content-addressed cache of idenRegion results.  The key
+// is a 64-bit FNV-1a hash of the printed function body, the module's data
+// layout and the analysis options; the value is the function's antidependence
+// pairs, paths, hitting set and cut blocks with every instruction named by
+// its InstNumbering index.  Each entry is one small text file in the cache
+// directory, written to a temporary name and renamed into place so that
+// concurrent builds never see a partial entry.  An entry also records the
+// size of the numbering; one that does not fit the function (a hash
+// collision, or a stale or edited file) is a miss.
+//
+// Hits refresh the entry's modification time.  evict() removes the least
+// recently used entries once the directory grows past its size limit,
+// trimming it to three quarters of the limit.  It also removes temporary files
+// that have not been written to for an hour; their writer died before the
+// rename.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_CUTSETCACHE_H
+#define IDENREGION_CUTSETCACHE_H
+
+#include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/raw_ostream.h"
+#include "InstNumbering.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <utime.h>
+
+namespace llvm {
+
+class CutSetCache {
+ public:
+    // One function's results, by instruction and block index.
+    struct Entry {
+        unsigned NumInsts, NumBlocks;
+        std::vector<std::pair<unsigned, unsigned> > Pairs;
+        std::vector<std::vector<unsigned> > Paths;
+        std::vector<unsigned> Cuts;
+        std::vector<unsigned> CutBlocks;
+
+        Entry() : NumInsts(0), NumBlocks(0) {}
+    };
+
+    CutSetCache() : MaxBytes_(0), Hits_(0), Misses_(0) {}
+
+    // An empty directory disables the cache.
+    void init(const std::string &Dir, uint64_t MaxBytes) {
+        Dir_ = Dir;
+        MaxBytes_ = MaxBytes;
+        if (!Dir_.empty())
+            mkdir(Dir_.c_str(), 0777);
+    }
+
+    bool enabled() const { return !Dir_.empty(); }
+
+    // Stable key for F analyzed under Options.
+    static uint64_t getKey(const Function &F, StringRef Options) {
+        std::string Body;
+        raw_string_ostream OS(Body);
+        F.print(OS);
+        OS.flush();
+
+        uint64_t Hash = 14695981039346656037ULL;
+        hash(Hash, Body);
+        hash(Hash, F.getParent()->getDataLayout());
+        hash(Hash, Options);
+        return Hash;
+    }
+
+    // Look up the entry of Key for the function numbered by N.
+    bool lookup(uint64_t Key, const InstNumbering &N, Entry &E) {
+        std::string Path = getPath(Key);
+        std::ifstream In(Path.c_str());
+        if (!In || !read(In, E) || !fits(E, N)) {
+            ++Misses_;
+            return false;
+        }
+        utime(Path.c_str(), NULL);   // mark as recently used
+        ++Hits_;
+        return true;
+    }
+
+    void store(uint64_t Key, const Entry &E) {
+        std::string Path = getPath(Key);
+        char Suffix[32];
+        snprintf(Suffix, sizeof(Suffix), ".tmp%ld", (long)getpid());
+        std::string Tmp = Path + Suffix;
+        {
+            std::ofstream Out(Tmp.c_str());
+            write(Out, E);
+            if (!Out)
+                return (void)std::remove(Tmp.c_str());
+        }
+        std::rename(Tmp.c_str(), Path.c_str());
+    }
+
+    // Drop abandoned temporary files, and least recently used entries while
+    // the cache is over its limit.
+    void evict() {
+        if (!enabled())
+            return;
+        DIR *D = opendir(Dir_.c_str());
+        if (!D)
+            return;
+
+        std::vector<std::pair<time_t, std::pair<off_t, std::string> > > Files;
+        uint64_t Total = 0;
+        time_t Stale = time(NULL) - 60 * 60;
+        while (struct dirent *DE = readdir(D)) {
+            std::string Name = DE->d_name;
+            bool IsTmp = Name.find(".cut.tmp") != std::string::npos;
+            if (!IsTmp &&
+                (Name.size() < 4 || Name.compare(Name.size() - 4, 4, ".cut")))
+                continue;
+            std::string Path = Dir_ + "/" + Name;
+            struct stat St;
+            if (stat(Path.c_str(), &St) != 0)
+                continue;
+            if (IsTmp) {
+                if (St.st_mtime < Stale)
+                    std::remove(Path.c_str());
+                continue;
+            }
+            Files.push_back(std::make_pair(St.st_mtime,
+                                           std::make_pair(St.st_size, Path)));
+            Total += St.st_size;
+        }
+        closedir(D);
+
+        if (MaxBytes_ == 0 || Total <= MaxBytes_)
+            return;
+        std::sort(Files.begin(), Files.end());
+        for (unsigned i = 0, e = Files.size(); i != e; ++i) {
+            if (Total <= MaxBytes_ / 4 * 3)
+                break;
+            if (std::remove(Files[i].second.second.c_str()) == 0)
+                Total -= Files[i].second.first;
+        }
+    }
+
+    void print(raw_ostream &OS) const {
+        OS << "Cut set cache: " << Hits_ << " hit, " << Misses_ << " miss\n";
+    }
+
+    //===------------------------------------------------------------------===//
+    // Conversion between pass data structures and entries
+    //===------------------------------------------------------------------===//
+
+    template <typename PairsT, typename PathsT, typename SetT>
+    static void save(const InstNumbering &N, const PairsT &Pairs,
+                     const PathsT &Paths, const SetT &Cuts, Entry &E) {
+        E.NumInsts = N.getNumInsts();
+        E.NumBlocks = N.getNumBlocks();
+        for (typename PairsT::const_iterator I = Pairs.begin(),
+             IE = Pairs.end(); I != IE; ++I)
+            E.Pairs.push_back(std::make_pair(N.getIndex(I->first),
+                                             N.getIndex(I->second)));
+        for (typename PathsT::const_iterator I = Paths.begin(),
+             IE = Paths.end(); I != IE; ++I) {
+            E.Paths.resize(E.Paths.size() + 1);
+            for (typename PathsT::value_type::const_iterator J = I->begin(),
+                 JE = I->end(); J != JE; ++J)
+                E.Paths.back().push_back(N.getIndex(*J));
+        }
+        for (typename SetT::const_iterator I = Cuts.begin(), IE = Cuts.end();
+             I != IE; ++I) {
+            E.Cuts.push_back(N.getIndex(*I));
+            E.CutBlocks.push_back(N.getIndex((*I)->getParent()));
+        }
+        std::sort(E.Cuts.begin(), E.Cuts.end());
+        std::sort(E.CutBlocks.begin(), E.CutBlocks.end());
+        E.CutBlocks.erase(std::unique(E.CutBlocks.begin(), E.CutBlocks.end()),
+                          E.CutBlocks.end());
+    }
+
+    template <typename PairsT, typename PathsT, typename SetT>
+    static void restore(const InstNumbering &N, const Entry &E, PairsT &Pairs,
+                        PathsT &Paths, SetT &Cuts) {
+        for (unsigned i = 0, e = E.Pairs.size(); i != e; ++i)
+            Pairs.push_back(std::make_pair(N.getInst(E.Pairs[i].first),
+                                           N.getInst(E.Pairs[i].second)));
+        for (unsigned i = 0, e = E.Paths.size(); i != e; ++i) {
+            Paths.resize(Paths.size() + 1);
+            for (unsigned j = 0, je = E.Paths[i].size(); j != je; ++j)
+                Paths.back().push_back(N.getInst(E.Paths[i][j]));
+        }
+        for (unsigned i = 0, e = E.Cuts.size(); i != e; ++i)
+            Cuts.insert(N.getInst(E.Cuts[i]));
+    }
+
+ private:
+    std::string Dir_;
+    uint64_t MaxBytes_;
+    unsigned Hits_, Misses_;
+
+    static void hash(uint64_t &Hash, StringRef S) {
+        for (unsigned i = 0, e = S.size(); i != e; ++i) {
+            Hash ^= (unsigned char)S[i];
+            Hash *= 1099511628211ULL;
+        }
+        Hash ^= 0xff;   // separator, so "ab"+"c" != "a"+"bc"
+        Hash *= 1099511628211ULL;
+    }
+
+    std::string getPath(uint64_t Key) const {
+        char Name[32];
+        snprintf(Name, sizeof(Name), "/%016llx.cut", (unsigned long long)Key);
+        return Dir_ + Name;
+    }
+
+    // Does every index of E name an instruction or block numbered by N?
+    static bool fits(const Entry &E, const InstNumbering &N) {
+        unsigned NumInsts = N.getNumInsts(), NumBlocks = N.getNumBlocks();
+        if (E.NumInsts != NumInsts || E.NumBlocks != NumBlocks)
+            return false;
+        for (unsigned i = 0, e = E.Pairs.size(); i != e; ++i)
+            if (E.Pairs[i].first >= NumInsts || E.Pairs[i].second >= NumInsts)
+                return false;
+        for (unsigned i = 0, e = E.Paths.size(); i != e; ++i)
+            if (!fits(E.Paths[i], NumInsts))
+                return false;
+        return fits(E.Cuts, NumInsts) && fits(E.CutBlocks, NumBlocks);
+    }
+
+    static bool fits(const std::vector<unsigned> &L, unsigned Size) {
+        for (unsigned i = 0, e = L.size(); i != e; ++i)
+            if (L[i] >= Size)
+                return false;
+        return true;
+    }
+
+    static void writeList(std::ostream &Out, const std::vector<unsigned> &L) {
+        Out << L.size();
+        for (unsigned i = 0, e = L.size(); i != e; ++i)
+            Out << ' ' << L[i];
+        Out << '\n';
+    }
+
+    static bool readList(std::istream &In, std::vector<unsigned> &L) {
+        unsigned Size;
+        if (!(In >> Size))
+            return false;
+        L.resize(Size);
+        for (unsigned i = 0; i != Size; ++i)
+            if (!(In >> L[i]))
+                return false;
+        return true;
+    }
+
+    static void write(std::ostream &Out, const Entry &E) {
+        Out << "idem-cut-cache 2\n";
+        Out << E.NumInsts << ' ' << E.NumBlocks << '\n';
+        Out << E.Pairs.size() << '\n';
+        for (unsigned i = 0, e = E.Pairs.size(); i != e; ++i)
+            Out << E.Pairs[i].first << ' ' << E.Pairs[i].second << '\n';
+        Out << E.Paths.size() << '\n';
+        for (unsigned i = 0, e = E.Paths.size(); i != e; ++i)
+            writeList(Out, E.Paths[i]);
+        writeList(Out, E.Cuts);
+        writeList(Out, E.CutBlocks);
+    }
+
+    static bool read(std::istream &In, Entry &E) {
+        std::string Magic;
+        unsigned Version, Size;
+        if (!(In >> Magic >> Version) || Magic != "idem-cut-cache" ||
+            Version != 2)
+            return false;
+        if (!(In >> E.NumInsts >> E.NumBlocks) || !(In >> Size))
+            return false;
+        E.Pairs.resize(Size);
+        for (unsigned i = 0; i != Size; ++i)
+            if (!(In >> E.Pairs[i].first >> E.Pairs[i].second))
+                return false;
+        if (!(In >> Size))
+            return false;
+        E.Paths.resize(Size);
+        for (unsigned i = 0; i != Size; ++i)
+            if (!readList(In, E.Paths[i]))
+                return false;
+        return readList(In, E.Cuts) && readList(In, E.CutBlocks);
+    }
+};
+
+} // End llvm namespace
+
+#endif
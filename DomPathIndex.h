@@ -0,0 +1,274 @@
+//===----------- DomPathIndex.h - Paths as dominator intervals ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a compact form of the antidependence paths.  The path
+// of a pair is the store plus every writer (store, memory intrinsic or
+// writing call) on the dominator chain between the load and the store, so it
+// is a contiguous run of the writers on the chain from the entry to the
+// store's block.
+//
+// Writers are numbered once per function, blocks in dominator tree preorder
+// and writers in block order, and each block records how many writers its
+// strict dominators hold (its base).  The depth of a writer, its base plus
+// the writers before it in its block, is its position on the chain of every
+// block it dominates.  A path is then (store block, Lo, Hi): the writers of
+// that block's chain with depth in [Lo, Hi], the store being at Hi.
+//
+// Building a path is O(1) and needs no block scans.  Membership and
+// containment are a preorder interval test (dominance) plus a depth interval
+// test, which lets duplicate and subsumed paths be dropped before any path
+// is written out; expand() lists the writers of a survivor.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_DOMPATHINDEX_H
+#define IDENREGION_DOMPATHINDEX_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/Dominators.h"
+#include "MemoryAccess.h"
+#include "PathReduction.h"
+#include <algorithm>
+#include <vector>
+
+namespace llvm {
+
+class DomPathIndex {
+ public:
+    // The writers of the chain of block Block whose depth is in [Lo, Hi].
+    struct DomPath {
+        unsigned Block, Lo, Hi;
+        unsigned size() const { return Hi - Lo + 1; }
+    };
+
+    // WritingCalls are the calls of F the pair search handles as stores (see
+    // FunctionSummaries::isWritingCall()).
+    void build(Function &F, DominatorTree &DT,
+               ArrayRef<Instruction *> WritingCalls =
+                   ArrayRef<Instruction *>()) {
+        Blocks_.clear();
+        BlockIdx_.clear();
+        Writers_.clear();
+        Insts_.clear();
+        WritingCalls_.clear();
+        WritingCalls_.insert(WritingCalls.begin(), WritingCalls.end());
+
+        // Dominator tree preorder; each unreachable block is a tree of its
+        // own.
+        std::vector<DomTreeNode *> Stack;
+        if (DomTreeNode *Root = DT.getRootNode())
+            Stack.push_back(Root);
+        while (!Stack.empty()) {
+            DomTreeNode *Node = Stack.back();
+            Stack.pop_back();
+            DomTreeNode *IDom = Node->getIDom();
+            addBlock(Node->getBlock(),
+                     IDom ? BlockIdx_.lookup(IDom->getBlock()) : NoBlock);
+            for (DomTreeNode::iterator I = Node->end(), E = Node->begin();
+                 I != E; )
+                Stack.push_back(*--I);
+        }
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            if (!BlockIdx_.count(BB))
+                addBlock(BB, NoBlock);
+
+        // Subtrees are contiguous in preorder; a block's ends at the last
+        // block of its children's.
+        for (unsigned B = Blocks_.size(); B-- != 0; ) {
+            unsigned P = Blocks_[B].Parent;
+            if (P != NoBlock && Blocks_[B].Last > Blocks_[P].Last)
+                Blocks_[P].Last = Blocks_[B].Last;
+        }
+    }
+
+    DomPath getPath(const Instruction *Load, const Instruction *Store) const {
+        const InstInfo &L = Insts_.find(Load)->second;
+        const InstInfo &S = Insts_.find(Store)->second;
+        DomPath P;
+        P.Block = S.Block;
+        P.Hi = P.Lo = Blocks_[S.Block].Base + S.Before;
+        if (L.Block == S.Block && L.Order < S.Order)
+            // The writers strictly between the two.
+            P.Lo = Blocks_[S.Block].Base + L.Before + L.Writer;
+        else if (L.Block == S.Block)
+            // Around a loop the whole block above the store is on the path.
+            P.Lo = Blocks_[S.Block].Base;
+        else if (dominates(L.Block, S.Block))
+            // A reader that also writes (memcpy/memmove, a writing call) is
+            // no cut of its own pair, as in the same block.
+            P.Lo = Blocks_[L.Block].Base + L.Before + L.Writer;
+        return P;
+    }
+
+    // Is writer W on path P?
+    bool contains(const DomPath &P, const Instruction *W) const {
+        const InstInfo &I = Insts_.find(W)->second;
+        unsigned Depth = Blocks_[I.Block].Base + I.Before;
+        return dominates(I.Block, P.Block) && P.Lo <= Depth && Depth <= P.Hi;
+    }
+
+    // Is every writer of Q on P?
+    bool contains(const DomPath &P, const DomPath &Q) const {
+        return dominates(Q.Block, P.Block) && P.Lo <= Q.Lo && Q.Hi <= P.Hi;
+    }
+
+    // Append the writers of P to Path, the store first and then up the
+    // chain, the order a walk of the dominator tree would find them in.
+    template <typename VectorT>
+    void expand(const DomPath &P, VectorT &Path) const {
+        unsigned B = P.Block, Depth = P.Hi;
+        for (;;) {
+            const BlockInfo &Info = Blocks_[B];
+            for (; Depth >= Info.Base && Depth >= P.Lo; --Depth) {
+                Path.push_back(Writers_[Info.First + Depth - Info.Base]);
+                if (Depth == 0)
+                    return;
+            }
+            if (Depth < P.Lo)
+                return;
+            B = Info.Up;
+        }
+    }
+
+    // Set Keep[i] for every path of Paths that is neither a duplicate nor a
+    // superset of another path; the same choice as reducePaths() makes on
+    // the expanded paths, without expanding them.
+    void reduce(const std::vector<DomPath> &Paths, std::vector<char> &Keep,
+                PathReductionStats &Stats) const {
+        unsigned N = Paths.size();
+        std::vector<unsigned> Order(N);
+        for (unsigned i = 0; i != N; ++i)
+            Order[i] = i;
+        std::sort(Order.begin(), Order.end(), ShorterDomPathFirst(Paths));
+
+        // Kept paths by their store.  A kept path inside Q ends at one of
+        // Q's writers and starts no higher than Q; there is at most one per
+        // store, as of two the longer would contain the shorter.
+        std::vector<unsigned> KeptLo(Writers_.size(), NoBlock);
+        Keep.assign(N, 0);
+        Stats.Paths += N;
+        for (unsigned o = 0; o != N; ++o) {
+            const DomPath &Q = Paths[Order[o]];
+            if (KeptLo[getWriterId(Q.Block, Q.Hi)] == Q.Lo) {
+                ++Stats.Duplicates;
+                continue;
+            }
+            if (hasKeptSubpath(Q, KeptLo)) {
+                ++Stats.Subsumed;
+                continue;
+            }
+            Keep[Order[o]] = 1;
+            KeptLo[getWriterId(Q.Block, Q.Hi)] = Q.Lo;
+        }
+    }
+
+ private:
+    enum { NoBlock = ~0U };
+
+    struct BlockInfo {
+        unsigned Parent;    // immediate dominator
+        unsigned Up;        // nearest strict dominator with writers
+        unsigned Last;      // last preorder number of the subtree
+        unsigned Base;      // writers in strict dominators
+        unsigned First;     // first writer in Writers_
+        unsigned NumWriters;
+    };
+
+    struct InstInfo {
+        unsigned Block;     // preorder number
+        unsigned Order;     // position in the block
+        unsigned Before;    // writers before it in the block
+        bool Writer;
+    };
+
+    std::vector<BlockInfo> Blocks_;                 // by preorder number
+    DenseMap<const BasicBlock *, unsigned> BlockIdx_;
+    std::vector<Instruction *> Writers_;            // by block, then order
+    DenseMap<const Instruction *, InstInfo> Insts_;
+    SmallPtrSet<const Instruction *, 8> WritingCalls_;
+
+    struct ShorterDomPathFirst {
+        const std::vector<DomPath> &Paths;
+        explicit ShorterDomPathFirst(const std::vector<DomPath> &P)
+            : Paths(P) {}
+        bool operator()(unsigned A, unsigned B) const {
+            if (Paths[A].size() != Paths[B].size())
+                return Paths[A].size() < Paths[B].size();
+            return A < B;
+        }
+    };
+
+    void addBlock(BasicBlock *BB, unsigned Parent) {
+        unsigned B = Blocks_.size();
+        BlockIdx_[BB] = B;
+        BlockInfo Info;
+        Info.Parent = Parent;
+        Info.Up = NoBlock;
+        Info.Last = B;
+        Info.Base = 0;
+        if (Parent != NoBlock) {
+            const BlockInfo &P = Blocks_[Parent];
+            Info.Up = P.NumWriters ? Parent : P.Up;
+            Info.Base = P.Base + P.NumWriters;
+        }
+        Info.First = Writers_.size();
+
+        unsigned Order = 0, Before = 0;
+        for (BasicBlock::iterator I = BB->begin(), E = BB->end(); I != E;
+             ++I) {
+            InstInfo &II = Insts_[I];
+            II.Block = B;
+            II.Order = Order++;
+            II.Before = Before;
+            II.Writer = isMemoryWriter(I) || WritingCalls_.count(I);
+            if (II.Writer) {
+                Writers_.push_back(I);
+                ++Before;
+            }
+        }
+        Info.NumWriters = Before;
+        Blocks_.push_back(Info);
+    }
+
+    // Does block A dominate block B?
+    bool dominates(unsigned A, unsigned B) const {
+        return A <= B && B <= Blocks_[A].Last;
+    }
+
+    unsigned getWriterId(unsigned B, unsigned Depth) const {
+        return Blocks_[B].First + Depth - Blocks_[B].Base;
+    }
+
+    bool hasKeptSubpath(const DomPath &Q,
+                        const std::vector<unsigned> &KeptLo) const {
+        unsigned B = Q.Block, Depth = Q.Hi;
+        for (;;) {
+            const BlockInfo &Info = Blocks_[B];
+            for (; Depth >= Info.Base && Depth >= Q.Lo; --Depth) {
+                unsigned Lo = KeptLo[getWriterId(B, Depth)];
+                if (Lo != NoBlock && Lo >= Q.Lo)
+                    return true;
+                if (Depth == 0)
+                    return false;
+            }
+            if (Depth < Q.Lo)
+                return false;
+            B = Info.Up;
+        }
+    }
+};
+
+} // End llvm namespace
+
+#endif
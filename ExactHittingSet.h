@@ -0,0 +1,309 @@
+//===-------- ExactHittingSet.h - Minimum hitting set search ------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a branch-and-bound search for a minimum hitting set of
+// the paths, for when the greedy cuts of GreedyHittingSet.h are too many.
+//
+// Every search node first applies the usual reductions until none fires:
+//
+//   - a path with a single candidate forces that candidate
+//   - a path that contains another path is hit whenever the smaller one is,
+//     so it is dropped (duplicates included)
+//   - a candidate whose paths are a subset of another candidate's paths is
+//     never needed and is dropped (of two with equal paths, the larger id)
+//
+// It then bounds the node by a packing of pairwise disjoint paths, each of
+// which needs a cut of its own, and branches on the candidates of the
+// shortest path, excluding the earlier candidates of that path from the
+// later branches.
+//
+// The search starts from the greedy answer and has a time budget.  When the
+// budget runs out it keeps the best set found so far and reports the bound
+// proved at the root, so callers can tell how far from optimal it may be.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_EXACTHITTINGSET_H
+#define IDENREGION_EXACTHITTINGSET_H
+
+#include "GreedyHittingSet.h"
+#include <algorithm>
+#include <vector>
+#include <sys/time.h>
+
+namespace llvm {
+
+class ExactHittingSet {
+ public:
+    explicit ExactHittingSet(unsigned NumCandidates)
+        : NumCandidates_(NumCandidates), LowerBound_(0), GreedySize_(0),
+          Nodes_(0), Deadline_(0), TimedOut_(false) {}
+
+    // Add a path through the candidates [Begin, End).
+    template <typename IterT>
+    void addPath(IterT Begin, IterT End) {
+        PathTy Path(Begin, End);
+        std::sort(Path.begin(), Path.end());
+        Path.erase(std::unique(Path.begin(), Path.end()), Path.end());
+        Paths_.push_back(Path);
+    }
+
+    // Append a minimum hitting set to Picks.  If the search takes longer
+    // than BudgetMS milliseconds (0 = no limit), append the best set found
+    // instead, which is at worst the greedy one.  Returns true if the set is
+    // proved minimum.  A path without candidates cannot be hit and is
+    // ignored.
+    bool solve(unsigned BudgetMS, std::vector<unsigned> &Picks) {
+        PathListTy Root;
+        GreedyHittingSet Greedy(NumCandidates_);
+        for (unsigned i = 0, e = Paths_.size(); i != e; ++i) {
+            if (Paths_[i].empty())
+                continue;
+            Root.push_back(Paths_[i]);
+            Greedy.addPath(Paths_[i].begin(), Paths_[i].end());
+        }
+        Best_.clear();
+        Greedy.solve(Best_);
+        GreedySize_ = Best_.size();
+
+        Deadline_ = BudgetMS ? now() + BudgetMS * 1e-3 : 0;
+        TimedOut_ = false;
+        Nodes_ = 0;
+
+        std::vector<unsigned> Chosen;
+        if (reduce(Root, Chosen)) {
+            LowerBound_ = Chosen.size() + packingBound(Root);
+            search(Root, Chosen);
+        }
+        if (!TimedOut_)
+            LowerBound_ = Best_.size();
+        Picks.insert(Picks.end(), Best_.begin(), Best_.end());
+        return !TimedOut_;
+    }
+
+    // The lower bound the last solve() proved on the minimum.
+    unsigned getLowerBound() const { return LowerBound_; }
+
+    // The size of the greedy hitting set the last solve() started from.
+    unsigned getGreedySize() const { return GreedySize_; }
+
+    // Search nodes visited by the last solve().
+    unsigned getNodes() const { return Nodes_; }
+
+ private:
+    typedef std::vector<unsigned> PathTy;   // sorted candidate ids
+    typedef std::vector<PathTy> PathListTy;
+
+    unsigned NumCandidates_;
+    PathListTy Paths_;
+    std::vector<unsigned> Best_;
+    unsigned LowerBound_, GreedySize_, Nodes_;
+    double Deadline_;
+    bool TimedOut_;
+
+    static double now() {
+        struct timeval TV;
+        gettimeofday(&TV, 0);
+        return TV.tv_sec + TV.tv_usec * 1e-6;
+    }
+
+    struct ShorterPath {
+        bool operator()(const PathTy &A, const PathTy &B) const {
+            if (A.size() != B.size())
+                return A.size() < B.size();
+            return A < B;
+        }
+    };
+
+    // Apply the reductions until none fires, appending forced candidates to
+    // Forced.  Returns false if some path has no candidate left.
+    bool reduce(PathListTy &Paths, std::vector<unsigned> &Forced) {
+        for (;;) {
+            std::vector<char> Take(NumCandidates_, 0);
+            bool AnyTaken = false;
+            for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+                if (Paths[i].empty())
+                    return false;
+                if (Paths[i].size() == 1 && !Take[Paths[i][0]]) {
+                    Take[Paths[i][0]] = 1;
+                    Forced.push_back(Paths[i][0]);
+                    AnyTaken = true;
+                }
+            }
+            if (AnyTaken) {
+                removeHitPaths(Paths, Take);
+                continue;
+            }
+            bool Changed = removeSubsumedPaths(Paths);
+            if (removeDominatedCandidates(Paths))
+                Changed = true;
+            if (!Changed)
+                return true;
+        }
+    }
+
+    static bool hitsAny(const PathTy &Path, const std::vector<char> &Set) {
+        for (unsigned j = 0, je = Path.size(); j != je; ++j)
+            if (Set[Path[j]])
+                return true;
+        return false;
+    }
+
+    static void removeHitPaths(PathListTy &Paths,
+                               const std::vector<char> &Taken) {
+        unsigned Kept = 0;
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+            if (!hitsAny(Paths[i], Taken))
+                Paths[Kept++].swap(Paths[i]);
+        Paths.resize(Kept);
+    }
+
+    // Sorts Paths shortest first and drops every path that contains another.
+    bool removeSubsumedPaths(PathListTy &Paths) {
+        unsigned Size = Paths.size();
+        std::sort(Paths.begin(), Paths.end(), ShorterPath());
+        Paths.erase(std::unique(Paths.begin(), Paths.end()), Paths.end());
+
+        // Kept paths by their first candidate.  A kept path inside Q starts
+        // with one of Q's candidates.
+        std::vector<std::vector<unsigned> > ByFirst(NumCandidates_);
+        unsigned Kept = 0;
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+            const PathTy &Q = Paths[i];
+            bool Subsumed = false;
+            for (unsigned j = 0, je = Q.size(); j != je && !Subsumed; ++j) {
+                const std::vector<unsigned> &Starts = ByFirst[Q[j]];
+                for (unsigned k = 0, ke = Starts.size(); k != ke; ++k) {
+                    const PathTy &P = Paths[Starts[k]];
+                    if (std::includes(Q.begin() + j, Q.end(),
+                                      P.begin(), P.end())) {
+                        Subsumed = true;
+                        break;
+                    }
+                }
+            }
+            if (Subsumed)
+                continue;
+            ByFirst[Q[0]].push_back(Kept);
+            Paths[Kept++].swap(Paths[i]);
+        }
+        Paths.resize(Kept);
+        return Kept != Size;
+    }
+
+    bool removeDominatedCandidates(PathListTy &Paths) {
+        std::vector<std::vector<unsigned> > PathsOf(NumCandidates_);
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+            for (unsigned j = 0, je = Paths[i].size(); j != je; ++j)
+                PathsOf[Paths[i][j]].push_back(i);
+
+        std::vector<char> Dropped(NumCandidates_, 0);
+        bool AnyDropped = false;
+        for (unsigned C = 0; C != NumCandidates_; ++C) {
+            const std::vector<unsigned> &Mine = PathsOf[C];
+            if (Mine.empty())
+                continue;
+            // Any dominating candidate lies on C's first path.
+            const PathTy &First = Paths[Mine[0]];
+            for (unsigned j = 0, je = First.size(); j != je; ++j) {
+                unsigned D = First[j];
+                if (D == C || Dropped[D])
+                    continue;
+                const std::vector<unsigned> &Theirs = PathsOf[D];
+                if (Theirs.size() == Mine.size() && D > C)
+                    continue;
+                if (std::includes(Theirs.begin(), Theirs.end(),
+                                  Mine.begin(), Mine.end())) {
+                    Dropped[C] = 1;
+                    AnyDropped = true;
+                    break;
+                }
+            }
+        }
+        if (!AnyDropped)
+            return false;
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+            PathTy &Path = Paths[i];
+            unsigned Kept = 0;
+            for (unsigned j = 0, je = Path.size(); j != je; ++j)
+                if (!Dropped[Path[j]])
+                    Path[Kept++] = Path[j];
+            Path.resize(Kept);
+        }
+        return true;
+    }
+
+    // Size of a greedy packing of pairwise disjoint paths, shortest first.
+    // Paths is sorted shortest first by the reductions.
+    unsigned packingBound(const PathListTy &Paths) const {
+        std::vector<char> Used(NumCandidates_, 0);
+        unsigned Packed = 0;
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+            if (hitsAny(Paths[i], Used))
+                continue;
+            for (unsigned j = 0, je = Paths[i].size(); j != je; ++j)
+                Used[Paths[i][j]] = 1;
+            ++Packed;
+        }
+        return Packed;
+    }
+
+    // Paths is reduced; Chosen holds the candidates picked above this node.
+    void search(const PathListTy &Paths, std::vector<unsigned> &Chosen) {
+        if (Deadline_ && (++Nodes_ & 63) == 0 && now() > Deadline_)
+            TimedOut_ = true;
+        if (TimedOut_)
+            return;
+        if (Paths.empty()) {
+            if (Chosen.size() < Best_.size())
+                Best_ = Chosen;
+            return;
+        }
+        if (Chosen.size() + packingBound(Paths) >= Best_.size())
+            return;
+
+        // Branch on the shortest path, most frequent candidates first.
+        std::vector<unsigned> Count(NumCandidates_, 0);
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+            for (unsigned j = 0, je = Paths[i].size(); j != je; ++j)
+                ++Count[Paths[i][j]];
+        std::vector<std::pair<unsigned, unsigned> > Order;
+        for (unsigned j = 0, je = Paths[0].size(); j != je; ++j)
+            Order.push_back(std::make_pair(~0U - Count[Paths[0][j]],
+                                           Paths[0][j]));
+        std::sort(Order.begin(), Order.end());
+
+        std::vector<char> Taken(NumCandidates_, 0), Excluded(NumCandidates_, 0);
+        for (unsigned b = 0, be = Order.size(); b != be && !TimedOut_; ++b) {
+            unsigned C = Order[b].second;
+            Taken[C] = 1;
+            PathListTy Child;
+            for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+                if (hitsAny(Paths[i], Taken))
+                    continue;
+                Child.push_back(PathTy());
+                for (unsigned j = 0, je = Paths[i].size(); j != je; ++j)
+                    if (!Excluded[Paths[i][j]])
+                        Child.back().push_back(Paths[i][j]);
+            }
+            Taken[C] = 0;
+            Excluded[C] = 1;
+
+            unsigned Base = Chosen.size();
+            Chosen.push_back(C);
+            if (reduce(Child, Chosen))
+                search(Child, Chosen);
+            Chosen.resize(Base);
+        }
+    }
+};
+
+} // End llvm namespace
+
+#endif
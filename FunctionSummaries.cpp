@@ -0,0 +1,349 @@
+//===-- FunctionSummaries.cpp - Interprocedural memory summaries ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Implementation of the FunctionSummaries module analysis.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "idenRegion"
+#include "FunctionSummaries.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Module.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/Analysis/CallGraph.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Target/TargetData.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+char FunctionSummaries::ID = 0;
+static RegisterPass<FunctionSummaries> X("idem-summaries",
+    "Interprocedural memory summaries for idenRegion", false, true);
+
+// Print the globals by name; the set iterates in pointer order, which changes
+// from run to run and would change the cache keys built from the summaries.
+static void printGlobals(raw_ostream &OS,
+                         const SmallPtrSet<const GlobalValue *, 8> &Globals) {
+    std::vector<std::string> Names;
+    for (SmallPtrSet<const GlobalValue *, 8>::const_iterator
+         I = Globals.begin(), E = Globals.end(); I != E; ++I)
+        Names.push_back((*I)->getName());
+    std::sort(Names.begin(), Names.end());
+    for (unsigned i = 0, e = Names.size(); i != e; ++i)
+        OS << " @" << Names[i];
+}
+
+void FunctionSummary::print(raw_ostream &OS) const {
+    OS << "reads:";
+    if (ReadsUnknown)
+        OS << " unknown";
+    for (unsigned i = 0; i != 64; ++i)
+        if (ReadArgs & (1ULL << i))
+            OS << " arg" << i;
+    printGlobals(OS, ReadGlobals);
+    OS << "; writes:";
+    if (WritesUnknown)
+        OS << " unknown";
+    for (unsigned i = 0; i != 64; ++i)
+        if (WriteArgs & (1ULL << i))
+            OS << " arg" << i;
+    printGlobals(OS, WriteGlobals);
+    OS << (SideEffects ? "; side effects" : "")
+       << (Idempotent ? "; idempotent" : "; not idempotent");
+}
+
+void FunctionSummaries::getAnalysisUsage(AnalysisUsage &AU) const {
+    AU.addRequired<AliasAnalysis>();
+    AU.addRequired<CallGraph>();
+    AU.setPreservesAll();
+}
+
+// Record an access to the memory Ptr points into.
+void FunctionSummaries::addAccess(const Value *Ptr, bool IsWrite,
+                                  FunctionSummary &S) const {
+    const Value *Obj = GetUnderlyingObject(Ptr, TD_);
+    if (isa<AllocaInst>(Obj) || isNoAliasCall(Obj))
+        return;     // private to this invocation
+
+    if (const GlobalValue *GV = dyn_cast<GlobalValue>(Obj)) {
+        (IsWrite ? S.WriteGlobals : S.ReadGlobals).insert(GV);
+        return;
+    }
+    if (const Argument *A = dyn_cast<Argument>(Obj)) {
+        if (A->getArgNo() < 64) {
+            (IsWrite ? S.WriteArgs : S.ReadArgs) |= 1ULL << A->getArgNo();
+            return;
+        }
+    }
+    (IsWrite ? S.WritesUnknown : S.ReadsUnknown) = true;
+}
+
+// What a callee we cannot look into does, from its mod/ref behavior.
+void FunctionSummaries::summarizeDeclaration(AliasAnalysis::ModRefBehavior MRB,
+                                             unsigned NumArgs,
+                                             FunctionSummary &S) const {
+    if (MRB == AliasAnalysis::DoesNotAccessMemory)
+        return;
+
+    uint64_t AllArgs = NumArgs >= 64 ? ~0ULL : (1ULL << NumArgs) - 1;
+    if (AliasAnalysis::onlyAccessesArgPointees(MRB) && NumArgs <= 64) {
+        if (AliasAnalysis::doesAccessArgPointees(MRB)) {
+            S.ReadArgs |= AllArgs;
+            if (!AliasAnalysis::onlyReadsMemory(MRB))
+                S.WriteArgs |= AllArgs;
+        }
+        return;
+    }
+
+    S.ReadsUnknown = true;
+    if (AliasAnalysis::onlyReadsMemory(MRB))
+        return;
+    S.WritesUnknown = true;
+    S.SideEffects = true;
+}
+
+FunctionSummary FunctionSummaries::getCallSummary(ImmutableCallSite CS) const {
+    FunctionSummary S;
+    const Function *Callee = CS.getCalledFunction();
+    if (const FunctionSummary *CalleeS = getSummary(Callee))
+        S = *CalleeS;
+    else {
+        summarizeDeclaration(AA_->getModRefBehavior(CS), CS.arg_size(), S);
+        computeIdempotent(S);
+    }
+    return S;
+}
+
+// Fold the effect of a call into the summary of its caller, mapping the
+// callee's argument pointees onto the actual arguments.
+void FunctionSummaries::addCall(ImmutableCallSite CS,
+                                FunctionSummary &S) const {
+    if (isa<DbgInfoIntrinsic>(CS.getInstruction()))
+        return;
+    // Memory intrinsics touch exactly their source and destination
+    if (const MemIntrinsic *MI = dyn_cast<MemIntrinsic>(CS.getInstruction())) {
+        S.SideEffects |= MI->isVolatile();
+        addAccess(MI->getRawDest(), true, S);
+        if (const MemTransferInst *MTI = dyn_cast<MemTransferInst>(MI))
+            addAccess(MTI->getRawSource(), false, S);
+        return;
+    }
+
+    FunctionSummary Callee = getCallSummary(CS);
+    S.ReadsUnknown |= Callee.ReadsUnknown;
+    S.WritesUnknown |= Callee.WritesUnknown;
+    S.SideEffects |= Callee.SideEffects;
+    S.ReadGlobals.insert(Callee.ReadGlobals.begin(), Callee.ReadGlobals.end());
+    S.WriteGlobals.insert(Callee.WriteGlobals.begin(),
+                          Callee.WriteGlobals.end());
+    for (unsigned i = 0; i != 64; ++i) {
+        uint64_t Bit = 1ULL << i;
+        if (!((Callee.ReadArgs | Callee.WriteArgs) & Bit))
+            continue;
+        if (i >= CS.arg_size()) {
+            // Variadic or mismatched call
+            S.ReadsUnknown |= (Callee.ReadArgs & Bit) != 0;
+            S.WritesUnknown |= (Callee.WriteArgs & Bit) != 0;
+            continue;
+        }
+        const Value *Arg = CS.getArgument(i);
+        if (!Arg->getType()->isPointerTy())
+            continue;
+        if (Callee.ReadArgs & Bit)
+            addAccess(Arg, false, S);
+        if (Callee.WriteArgs & Bit)
+            addAccess(Arg, true, S);
+    }
+}
+
+void FunctionSummaries::summarize(Function &F, FunctionSummary &S) const {
+    for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+        for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+             I != IE; ++I) {
+            if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+                S.SideEffects |= !Load->isUnordered();
+                addAccess(Load->getPointerOperand(), false, S);
+            } else if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+                S.SideEffects |= !Store->isUnordered();
+                addAccess(Store->getPointerOperand(), true, S);
+            } else if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+                addCall(ImmutableCallSite(&*I), S);
+            } else if (I->mayReadFromMemory() || I->mayWriteToMemory()) {
+                // atomics, fences and va_arg
+                S.ReadsUnknown = S.WritesUnknown = S.SideEffects = true;
+            }
+        }
+}
+
+// A summary whose reads and writes cannot overlap is idempotent.  Argument
+// pointees may alias each other and any global, so they only count as
+// disjoint from the other side when it is empty.
+void FunctionSummaries::computeIdempotent(FunctionSummary &S) {
+    S.Idempotent = false;
+    if (S.SideEffects)
+        return;
+    if (!S.reads() || !S.writes()) {
+        S.Idempotent = true;
+        return;
+    }
+    if (S.ReadsUnknown || S.WritesUnknown || S.ReadArgs || S.WriteArgs)
+        return;
+    for (SmallPtrSet<const GlobalValue *, 8>::const_iterator
+         I = S.ReadGlobals.begin(), E = S.ReadGlobals.end(); I != E; ++I)
+        if (S.WriteGlobals.count(*I))
+            return;
+    S.Idempotent = true;
+}
+
+bool FunctionSummaries::runOnModule(Module &M) {
+    AA_ = &getAnalysis<AliasAnalysis>();
+    TD_ = AA_->getTargetData();
+    Summaries_.clear();
+
+    // Callees come before their callers; each recursive SCC is iterated until
+    // its summaries stop growing.  Summaries only ever grow, so comparing
+    // their sizes is enough to detect the fixpoint.
+    CallGraph &CG = getAnalysis<CallGraph>();
+    for (scc_iterator<CallGraph *> SCC = scc_begin(&CG), E = scc_end(&CG);
+         SCC != E; ++SCC) {
+        std::vector<Function *> Fns;
+        for (std::vector<CallGraphNode *>::const_iterator I = (*SCC).begin(),
+             IE = (*SCC).end(); I != IE; ++I) {
+            Function *F = (*I)->getFunction();
+            if (F && !F->isDeclaration()) {
+                Summaries_[F];
+                Fns.push_back(F);
+            }
+        }
+
+        bool Changed = true;
+        while (Changed) {
+            Changed = false;
+            for (unsigned i = 0, e = Fns.size(); i != e; ++i) {
+                FunctionSummary &S = Summaries_[Fns[i]];
+                FunctionSummary Old = S;
+                summarize(*Fns[i], S);
+                Changed |= S.ReadsUnknown != Old.ReadsUnknown ||
+                           S.WritesUnknown != Old.WritesUnknown ||
+                           S.SideEffects != Old.SideEffects ||
+                           S.ReadArgs != Old.ReadArgs ||
+                           S.WriteArgs != Old.WriteArgs ||
+                           S.ReadGlobals.size() != Old.ReadGlobals.size() ||
+                           S.WriteGlobals.size() != Old.WriteGlobals.size();
+            }
+        }
+        for (unsigned i = 0, e = Fns.size(); i != e; ++i)
+            computeIdempotent(Summaries_[Fns[i]]);
+    }
+    return false;
+}
+
+// Can the call read (or, for IsWrite, write) any of the Size bytes at Ptr?
+bool FunctionSummaries::callMayAccess(ImmutableCallSite CS, bool IsWrite,
+                                      const Value *Ptr, uint64_t Size) const {
+    if (isa<DbgInfoIntrinsic>(CS.getInstruction()))
+        return false;
+    if (!(AA_->getModRefInfo(CS, Ptr, Size) &
+          (IsWrite ? AliasAnalysis::Mod : AliasAnalysis::Ref)))
+        return false;
+
+    FunctionSummary Callee = getCallSummary(CS);
+    if (IsWrite ? Callee.WritesUnknown : Callee.ReadsUnknown)
+        return true;
+    const SmallPtrSet<const GlobalValue *, 8> &Globals =
+        IsWrite ? Callee.WriteGlobals : Callee.ReadGlobals;
+    for (SmallPtrSet<const GlobalValue *, 8>::const_iterator
+         I = Globals.begin(), E = Globals.end(); I != E; ++I)
+        if (AA_->alias(Ptr, Size, *I, AliasAnalysis::UnknownSize))
+            return true;
+    uint64_t Args = IsWrite ? Callee.WriteArgs : Callee.ReadArgs;
+    for (unsigned i = 0, e = CS.arg_size(); i != e && i != 64; ++i)
+        if ((Args & (1ULL << i)) &&
+            CS.getArgument(i)->getType()->isPointerTy() &&
+            AA_->alias(Ptr, Size, CS.getArgument(i),
+                       AliasAnalysis::UnknownSize))
+            return true;
+    return false;
+}
+
+// Ask about each piece of memory the reader's callee reads in turn.
+bool FunctionSummaries::callMayReadCall(ImmutableCallSite Reader,
+                                        ImmutableCallSite Writer) const {
+    if (isa<DbgInfoIntrinsic>(Reader.getInstruction()))
+        return false;
+    FunctionSummary Callee = getCallSummary(Reader);
+    if (Callee.ReadsUnknown)
+        return getCallSummary(Writer).writes();
+    for (SmallPtrSet<const GlobalValue *, 8>::const_iterator
+         I = Callee.ReadGlobals.begin(), E = Callee.ReadGlobals.end();
+         I != E; ++I)
+        if (callMayWrite(Writer, *I, AliasAnalysis::UnknownSize))
+            return true;
+    for (unsigned i = 0, e = Reader.arg_size(); i != e && i != 64; ++i)
+        if ((Callee.ReadArgs & (1ULL << i)) &&
+            Reader.getArgument(i)->getType()->isPointerTy() &&
+            callMayWrite(Writer, Reader.getArgument(i),
+                         AliasAnalysis::UnknownSize))
+            return true;
+    return false;
+}
+
+bool FunctionSummaries::isWritingCall(const Instruction &I) const {
+    if (!(isa<CallInst>(I) || isa<InvokeInst>(I)) ||
+        isa<DbgInfoIntrinsic>(I) || isa<MemIntrinsic>(I))
+        return false;
+    FunctionSummary Callee = getCallSummary(ImmutableCallSite(&I));
+    return Callee.Idempotent && Callee.writes();
+}
+
+unsigned FunctionSummaries::getForcedCuts(const Instruction &I) const {
+    if (const LoadInst *Load = dyn_cast<LoadInst>(&I))
+        return Load->isUnordered() ? NoCut : CutBefore | CutAfter;
+    if (const StoreInst *Store = dyn_cast<StoreInst>(&I))
+        return Store->isUnordered() ? NoCut : CutBefore | CutAfter;
+    if (const MemIntrinsic *MI = dyn_cast<MemIntrinsic>(&I))
+        return MI->isVolatile() ? CutBefore | CutAfter : NoCut;
+    if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+        if (isa<DbgInfoIntrinsic>(I))
+            return NoCut;
+        FunctionSummary Callee = getCallSummary(ImmutableCallSite(&I));
+        if (Callee.SideEffects)
+            return CutBefore | CutAfter;
+        return Callee.writes() && !Callee.Idempotent ? CutBefore : NoCut;
+    }
+    if (isa<VAArgInst>(I) || isa<FenceInst>(I) || isa<AtomicCmpXchgInst>(I) ||
+        isa<AtomicRMWInst>(I))
+        return CutBefore | CutAfter;
+    return NoCut;
+}
+
+std::string FunctionSummaries::getCalleeKey(const Function &F) const {
+    std::string Key;
+    raw_string_ostream OS(Key);
+    for (Function::const_iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+        for (BasicBlock::const_iterator I = BB->begin(), IE = BB->end();
+             I != IE; ++I)
+            if (isa<CallInst>(I) || isa<InvokeInst>(I)) {
+                getCallSummary(ImmutableCallSite(&*I)).print(OS);
+                OS << "\n";
+            }
+    return OS.str();
+}
+
+void FunctionSummaries::print(raw_ostream &OS, const Module *M) const {
+    for (Module::const_iterator F = M->begin(), E = M->end(); F != E; ++F)
+        if (const FunctionSummary *S = getSummary(F)) {
+            OS << F->getName() << ": ";
+            S->print(OS);
+            OS << "\n";
+        }
+}
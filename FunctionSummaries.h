@@ -0,0 +1,167 @@
+//===-- FunctionSummaries.h - Interprocedural memory summaries --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a module analysis that summarizes, for every function,
+// the memory a call to it may read and write, whether it has side effects
+// that make re-execution unsafe, and whether it is idempotent on its own.
+// Summaries are computed once per module, bottom-up over the call graph; the
+// functions of a recursive SCC are iterated to a fixpoint.
+//
+// Memory is described relative to the callee: the pointees of its arguments,
+// the globals it names, and "unknown" for everything else.  Stack memory of
+// the callee itself and memory it allocates are invisible to the caller and
+// are left out.  Declarations are summarized from their AliasAnalysis mod/ref
+// behavior.
+//
+// The idenRegion passes use the summaries in two places:
+//
+//   - pair discovery treats a call as a load of everything its callee may
+//     read, so (call, store) antidependences are found like (load, store)
+//   - pair discovery also treats a call to an idempotent callee that writes
+//     memory as a store of everything the callee may write, so its region
+//     only needs a cut where it overwrites something read before it
+//   - cut forcing: calls with side effects are isolated by cuts on both sides
+//     like volatile and atomic accesses, and other calls that write memory get
+//     a cut in front of them so they never overwrite what their own region
+//     read.  Read-only and idempotent calls force nothing, and neither do
+//     memset/memcpy/memmove, which the pair search handles as sized loads and
+//     stores.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_FUNCTIONSUMMARIES_H
+#define IDENREGION_FUNCTIONSUMMARIES_H
+
+#include "llvm/Function.h"
+#include "llvm/GlobalValue.h"
+#include "llvm/Instructions.h"
+#include "llvm/Pass.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Support/CallSite.h"
+#include "llvm/Support/raw_ostream.h"
+#include <string>
+
+namespace llvm {
+
+class TargetData;
+
+struct FunctionSummary {
+    bool ReadsUnknown, WritesUnknown;   // memory not named below
+    SmallPtrSet<const GlobalValue *, 8> ReadGlobals, WriteGlobals;
+    uint64_t ReadArgs, WriteArgs;       // bit i: pointee of argument i
+    bool SideEffects;                   // I/O, volatile, atomics, unknown code
+    bool Idempotent;                    // safe to re-execute as a whole
+
+    FunctionSummary()
+        : ReadsUnknown(false), WritesUnknown(false), ReadArgs(0), WriteArgs(0),
+          SideEffects(false), Idempotent(true) {}
+
+    bool reads() const {
+        return ReadsUnknown || ReadArgs || !ReadGlobals.empty();
+    }
+    bool writes() const {
+        return WritesUnknown || WriteArgs || !WriteGlobals.empty();
+    }
+
+    void print(raw_ostream &OS) const;
+};
+
+class FunctionSummaries : public ModulePass {
+ public:
+    static char ID; // Pass identification, replacement for typeid
+
+    // Where getForcedCuts() wants a cut, relative to the instruction.
+    enum { NoCut = 0, CutBefore = 1, CutAfter = 2 };
+
+    FunctionSummaries() : ModulePass(ID), AA_(0), TD_(0) {}
+
+    virtual void getAnalysisUsage(AnalysisUsage &AU) const;
+    virtual bool runOnModule(Module &M);
+    virtual void releaseMemory() { Summaries_.clear(); }
+    virtual void print(raw_ostream &OS, const Module *M) const;
+
+    // Summary of F, or null if F was not part of the analyzed module.
+    const FunctionSummary *getSummary(const Function *F) const {
+        DenseMap<const Function *, FunctionSummary>::const_iterator It =
+            Summaries_.find(F);
+        return It == Summaries_.end() ? 0 : &It->second;
+    }
+
+    // Summary of what a call does, in terms of its callee.
+    FunctionSummary getCallSummary(ImmutableCallSite CS) const;
+
+    // Can the call read any of the Size bytes at Ptr?
+    bool callMayRead(ImmutableCallSite CS, const Value *Ptr,
+                     uint64_t Size) const {
+        return callMayAccess(CS, false, Ptr, Size);
+    }
+
+    // Can the call write any of the Size bytes at Ptr?
+    bool callMayWrite(ImmutableCallSite CS, const Value *Ptr,
+                      uint64_t Size) const {
+        return callMayAccess(CS, true, Ptr, Size);
+    }
+
+    // Can call Reader read anything call Writer may write?
+    bool callMayReadCall(ImmutableCallSite Reader,
+                         ImmutableCallSite Writer) const;
+
+    // Is I a call the pair search handles as a writer?  Those are the calls
+    // to idempotent callees that write memory: re-executing such a call is
+    // safe unless it overwrites something its region read before it.
+    bool isWritingCall(const Instruction &I) const;
+
+    // NoCut, or the CutBefore/CutAfter cuts instruction I needs.
+    unsigned getForcedCuts(const Instruction &I) const;
+
+    // Insert into Cuts the instruction at every forced cut of F.  The cut
+    // after an invoke goes to the top of its successors.
+    template <typename SetT>
+    void forceCuts(Function &F, SetT &Cuts) const {
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+                 I != IE; ++I) {
+                unsigned Forced = getForcedCuts(*I);
+                if (Forced & CutBefore)
+                    Cuts.insert(I);
+                if (!(Forced & CutAfter))
+                    continue;
+                if (TerminatorInst *TI = dyn_cast<TerminatorInst>(I)) {
+                    for (unsigned i = 0, e = TI->getNumSuccessors(); i != e; ++i)
+                        Cuts.insert(TI->getSuccessor(i)->getFirstNonPHI());
+                } else {
+                    Cuts.insert(llvm::next(I));
+                }
+            }
+    }
+
+    // A string that changes whenever the summary of a callee of F changes.
+    std::string getCalleeKey(const Function &F) const;
+
+ private:
+    AliasAnalysis *AA_;
+    const TargetData *TD_;
+    DenseMap<const Function *, FunctionSummary> Summaries_;
+
+    void summarize(Function &F, FunctionSummary &S) const;
+    void summarizeDeclaration(AliasAnalysis::ModRefBehavior MRB,
+                              unsigned NumArgs, FunctionSummary &S) const;
+    void addAccess(const Value *Ptr, bool IsWrite, FunctionSummary &S) const;
+    void addCall(ImmutableCallSite CS, FunctionSummary &S) const;
+    bool callMayAccess(ImmutableCallSite CS, bool IsWrite, const Value *Ptr,
+                       uint64_t Size) const;
+    static void computeIdempotent(FunctionSummary &S);
+};
+
+} // End llvm namespace
+
+#endif
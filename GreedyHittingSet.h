@@ -0,0 +1,174 @@
+//===------- GreedyHittingSet.h - Greedy hitting set over paths ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the greedy set cover approximation used to pick cut
+// points: repeatedly take the candidate that lies on the most paths no cut
+// hits yet, until every path is hit.
+//
+// Candidates are dense ids.  They are kept in an indexed binary max-heap
+// keyed on the number of unhit paths through them; taking a candidate hits
+// its paths, and each other candidate on a newly hit path drops by one with a
+// decrease-key.  Every (candidate, path) incidence is decremented at most
+// once, so a run costs O(L log C) for L incidences and C candidates.  Ties go
+// to the smallest id, which keeps the result independent of pointer values.
+//
+// Candidates may also carry a cost, e.g. how often a cut there would run,
+// and paths a weight, e.g. how often their antidependence was seen.  The heap
+// is then keyed on the weight of the unhit paths per unit of cost, the usual
+// greedy rule for weighted set cover; with the default unit costs and weights
+// it is the plain rule above.
+//
+// The class knows nothing about LLVM, so it can be driven from the passes
+// (see computeGreedyHittingSet() in AntiDepAnalysis.h) and from standalone
+// tools alike.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_GREEDYHITTINGSET_H
+#define IDENREGION_GREEDYHITTINGSET_H
+
+#include <vector>
+
+namespace llvm {
+
+class GreedyHittingSet {
+ public:
+    explicit GreedyHittingSet(unsigned NumCandidates)
+        : PathsOf_(NumCandidates), Count_(NumCandidates, 0),
+          Weight_(NumCandidates, 0.0), Cost_(NumCandidates, 1.0),
+          LastPath_(NumCandidates, ~0U) {}
+
+    // Set the cost of taking candidate C (default 1).  Must be positive.
+    void setCost(unsigned C, double Cost) { Cost_[C] = Cost; }
+
+    // Add a path of the given weight (must be positive) through the
+    // candidates [Begin, End).  Repeated candidates count once.
+    template <typename IterT>
+    void addPath(IterT Begin, IterT End, double Weight = 1.0) {
+        unsigned P = Paths_.size();
+        Paths_.resize(P + 1);
+        PathWeight_.push_back(Weight);
+        for (; Begin != End; ++Begin) {
+            unsigned C = *Begin;
+            if (LastPath_[C] == P)
+                continue;
+            LastPath_[C] = P;
+            Paths_[P].push_back(C);
+            PathsOf_[C].push_back(P);
+            ++Count_[C];
+            Weight_[C] += Weight;
+        }
+    }
+
+    // Append the chosen candidates to Picks, in the order they are taken.
+    // A path without candidates cannot be hit and is ignored.
+    void solve(std::vector<unsigned> &Picks) {
+        unsigned N = Count_.size();
+        Heap_.clear();
+        Pos_.assign(N, NotInHeap);
+        for (unsigned C = 0; C != N; ++C)
+            if (Count_[C]) {
+                Pos_[C] = Heap_.size();
+                Heap_.push_back(C);
+            }
+        for (unsigned i = Heap_.size() / 2; i-- != 0; )
+            siftDown(i);
+
+        std::vector<bool> Hit(Paths_.size(), false);
+        while (!Heap_.empty() && Count_[Heap_[0]]) {
+            unsigned C = Heap_[0];
+            remove(0);
+            Picks.push_back(C);
+            for (unsigned i = 0, e = PathsOf_[C].size(); i != e; ++i) {
+                unsigned P = PathsOf_[C][i];
+                if (Hit[P])
+                    continue;
+                Hit[P] = true;
+                for (unsigned j = 0, je = Paths_[P].size(); j != je; ++j) {
+                    unsigned O = Paths_[P][j];
+                    if (Pos_[O] == NotInHeap)
+                        continue;
+                    // No rounding left over once all its paths are hit
+                    Weight_[O] = --Count_[O] ? Weight_[O] - PathWeight_[P] : 0;
+                    siftDown(Pos_[O]);
+                }
+            }
+        }
+    }
+
+ private:
+    enum { NotInHeap = ~0U };
+
+    std::vector<std::vector<unsigned> > Paths_;     // path -> candidates
+    std::vector<std::vector<unsigned> > PathsOf_;   // candidate -> paths
+    std::vector<double> PathWeight_;                // by path
+    std::vector<unsigned> Count_;                   // unhit paths through it
+    std::vector<double> Weight_;                    // ... and their weight
+    std::vector<double> Cost_;                      // of taking it
+    std::vector<unsigned> LastPath_;                // dedup in addPath()
+    std::vector<unsigned> Heap_;                    // candidates, best first
+    std::vector<unsigned> Pos_;                     // candidate -> heap slot
+
+    // Should candidate A be taken before candidate B?  Compares the weight
+    // of the unhit paths per cost, cross-multiplied.
+    bool before(unsigned A, unsigned B) const {
+        double RatioA = Weight_[A] * Cost_[B], RatioB = Weight_[B] * Cost_[A];
+        if (RatioA != RatioB)
+            return RatioA > RatioB;
+        return A < B;
+    }
+
+    void place(unsigned Slot, unsigned C) {
+        Heap_[Slot] = C;
+        Pos_[C] = Slot;
+    }
+
+    void siftDown(unsigned Slot) {
+        unsigned C = Heap_[Slot], N = Heap_.size();
+        for (;;) {
+            unsigned Child = 2 * Slot + 1;
+            if (Child >= N)
+                break;
+            if (Child + 1 < N && before(Heap_[Child + 1], Heap_[Child]))
+                ++Child;
+            if (!before(Heap_[Child], C))
+                break;
+            place(Slot, Heap_[Child]);
+            Slot = Child;
+        }
+        place(Slot, C);
+    }
+
+    void siftUp(unsigned Slot) {
+        unsigned C = Heap_[Slot];
+        while (Slot) {
+            unsigned Parent = (Slot - 1) / 2;
+            if (!before(C, Heap_[Parent]))
+                break;
+            place(Slot, Heap_[Parent]);
+            Slot = Parent;
+        }
+        place(Slot, C);
+    }
+
+    void remove(unsigned Slot) {
+        unsigned C = Heap_[Slot], Last = Heap_.back();
+        Heap_.pop_back();
+        Pos_[C] = NotInHeap;
+        if (Slot == Heap_.size())
+            return;
+        place(Slot, Last);
+        siftDown(Slot);
+        siftUp(Pos_[Last]);
+    }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,86 @@
+//===---------- HittingSet.h - Hitting set over flat set lists ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the library interface of hittingSet.cpp, the greedy
+// hitting set for callers that want no per-element allocation: the sets come
+// in CSR form (one offset array, one node array) and every array the solver
+// needs is carved out of a block of memory the caller provides, so the
+// memory used is known before the solve and is linear in the input.
+//
+// The picks are those of GreedyHittingSet: the node on the most unhit sets
+// first, ties to the smallest id.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_HITTINGSET_H
+#define IDENREGION_HITTINGSET_H
+
+#include <stddef.h>
+#include <set>
+
+namespace llvm {
+
+// A bump allocator over caller memory.  Nothing is freed individually;
+// reset() makes the whole block available again.
+class HittingSetArena {
+ public:
+    HittingSetArena(void *Mem, size_t Size)
+        : Begin_(static_cast<char *>(Mem)), Cur_(Begin_), End_(Begin_ + Size) {}
+
+    // Room for N objects of type T, or 0 if the block is exhausted.
+    template <typename T>
+    T *allocate(size_t N) {
+        size_t Pad = (ALIGN - (size_t)Cur_ % ALIGN) % ALIGN;
+        if (Pad > (size_t)(End_ - Cur_) ||
+            N > ((size_t)(End_ - Cur_) - Pad) / sizeof(T))
+            return 0;
+        T *P = reinterpret_cast<T *>(Cur_ + Pad);
+        Cur_ += Pad + N * sizeof(T);
+        return P;
+    }
+
+    void reset() { Cur_ = Begin_; }
+    size_t getUsed() const { return Cur_ - Begin_; }
+
+    // Bytes needed for arrays of these many elements, alignment included.
+    template <typename T>
+    static size_t getSize(size_t N) { return N * sizeof(T) + ALIGN - 1; }
+
+ private:
+    enum { ALIGN = 16 };
+    char *Begin_, *Cur_, *End_;
+};
+
+// Sets over the nodes 0 .. NumNodes-1 in CSR form: set i is
+// Nodes[Start[i]] .. Nodes[Start[i+1]-1], and Start has NumSets+1 entries.
+// A node may repeat within a set.
+struct SetCollection {
+    unsigned NumNodes;
+    unsigned NumSets;
+    const unsigned *Start;
+    const unsigned *Nodes;
+};
+
+// Bytes of arena findHittingSet() needs for Sets.
+size_t getHittingSetArenaSize(const SetCollection &Sets);
+
+// Write a greedy hitting set of Sets to Picks, which must have room for
+// NumNodes entries, in the order the nodes are taken, and return its size.
+// Empty sets cannot be hit and are ignored.  Returns ~0U, leaving Picks
+// unspecified, if Arena has less room than getHittingSetArenaSize().
+unsigned findHittingSet(const SetCollection &Sets, HittingSetArena &Arena,
+                        unsigned *Picks);
+
+// The same over sets of arbitrary ids.
+std::set<unsigned> findHittingSet(
+    const std::set<std::set<unsigned> > &Collection);
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,165 @@
+//===-------- IdemOptions.cpp - Shared idenRegion options ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Definitions for the options declared in IdemOptions.h.
+//
+//===----------------------------------------------------------------------===//
+
+#include "IdemOptions.h"
+#include "llvm/Pass.h"
+#include "llvm/PassSupport.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <vector>
+
+using namespace llvm;
+
+cl::opt<PairEngineTy> llvm::PairEngine("idem-pair-engine",
+    cl::desc("How to find memory antidependence pairs"),
+    cl::init(DFSPairs),
+    cl::values(
+        clEnumValN(DFSPairs,        "dfs",      "reverse DFS from every store"),
+        clEnumValN(DataflowPairs,   "dataflow", "single backward dataflow"),
+        clEnumValN(CrossCheckPairs, "check",    "run both and diff the pairs"),
+        clEnumValEnd));
+
+cl::opt<HittingSetEngineTy> llvm::HittingSetEngine("idem-hitting-set-engine",
+    cl::desc("How to compute the greedy hitting set of the paths"),
+    cl::init(HeapCover),
+    cl::values(
+        clEnumValN(HeapCover,   "heap",   "indexed max-heap"),
+        clEnumValN(BitsetCover, "bitset", "bitset rows, SIMD popcount"),
+        clEnumValN(ArenaCover,  "arena",  "CSR sets in one arena"),
+        clEnumValEnd));
+
+cl::opt<bool> llvm::ReducePaths("idem-reduce-paths",
+    cl::desc("Drop duplicate and subsumed paths before the hitting set"),
+    cl::init(true));
+
+cl::opt<CutPriorityTy> llvm::CutPriorityPolicy("idem-cut-priority",
+    cl::desc("How the greedy hitting set ranks cut candidates"),
+    cl::init(PathCountCuts),
+    cl::values(
+        clEnumValN(PathCountCuts, "paths", "most unhit paths first"),
+        clEnumValN(LoopDepthCuts, "loops", "outer loops first, then paths"),
+        clEnumValEnd));
+
+cl::opt<bool> llvm::ExactHittingSetMode("idem-exact-hitting-set",
+    cl::desc("Search for a minimum hitting set (branch and bound)"),
+    cl::init(false));
+
+cl::opt<unsigned> llvm::ExactBudgetMS("idem-exact-budget-ms",
+    cl::desc("Time budget of the exact hitting set per function (0 = none)"),
+    cl::init(1000));
+
+cl::opt<bool> llvm::ProfileWeightedCuts("idem-profile-weights",
+    cl::desc("Weight cut candidates by profiled block counts"),
+    cl::init(false));
+
+cl::opt<std::string> llvm::MergedProfileFile("idem-profile-file",
+    cl::desc("Merged profile to read the block counts and profiled "
+             "dependences from (empty = ProfileInfo and LAMP)"),
+    cl::init(""));
+
+cl::opt<bool> llvm::IncrementalCuts("idem-incremental-cuts",
+    cl::desc("Repair the cached cut set when only profiled pairs changed"),
+    cl::init(false));
+
+cl::opt<unsigned> llvm::MinPairCount("idem-min-pair-count",
+    cl::desc("Profiled pairs seen fewer times are left to the static search"),
+    cl::init(0));
+
+cl::opt<unsigned> llvm::PairCountPercentile("idem-pair-percentile",
+    cl::desc("Trust the hottest profiled pairs covering this percent of "
+             "the observations"),
+    cl::init(100));
+
+cl::opt<bool> llvm::PairCountWeightedCuts("idem-pair-count-weights",
+    cl::desc("Weight antidependence paths by profiled pair counts"),
+    cl::init(false));
+
+cl::opt<std::string> llvm::LAMPFilterFile("idem-lamp-filter",
+    cl::desc("Write the memory operations LAMP has to profile to this file"),
+    cl::init(""));
+
+cl::opt<unsigned> llvm::AnalysisThreads("idem-threads",
+    cl::desc("Worker threads for idenRegion-module (0 = one per CPU)"),
+    cl::init(0));
+
+cl::opt<VerbosityTy> llvm::Verbosity("idem-verbose",
+    cl::desc("Diagnostics printed by the idenRegion passes"),
+    cl::init(SummaryOutput),
+    cl::values(
+        clEnumValN(QuietOutput,   "off",     "print nothing"),
+        clEnumValN(SummaryOutput, "summary", "per-function results"),
+        clEnumValN(TraceOutput,   "full",    "full trace of the analysis"),
+        clEnumValEnd));
+
+cl::opt<bool> llvm::LoopDistancePruning("idem-loop-distance",
+    cl::desc("Prune antidependences of disjoint affine loop accesses"),
+    cl::init(true));
+
+cl::opt<std::string> llvm::CutCacheDir("idem-cache-dir",
+    cl::desc("Directory of cached per-function cut sets (empty = off)"),
+    cl::init(""));
+
+cl::opt<unsigned> llvm::CutCacheMaxMB("idem-cache-max-mb",
+    cl::desc("Size limit of the cut set cache in megabytes (0 = no limit)"),
+    cl::init(256));
+
+namespace {
+    // The registered alias analyses the pass manager of P has available,
+    // i.e. the ones in P's alias analysis chain.
+    struct AliasAnalysisLister : public PassRegistrationListener {
+        const Pass &P;
+        const PassInfo *Group;
+        std::vector<std::string> Names;
+
+        explicit AliasAnalysisLister(const Pass &Pa)
+            : P(Pa), Group(PassRegistry::getPassRegistry()->getPassInfo(
+                               &AliasAnalysis::ID)) {}
+
+        virtual void passEnumerate(const PassInfo *PI) {
+            const std::vector<const PassInfo *> &Ifs =
+                PI->getInterfacesImplemented();
+            if (std::find(Ifs.begin(), Ifs.end(), Group) == Ifs.end())
+                return;
+            if (P.getResolver()->getAnalysisIfAvailable(PI->getTypeInfo(),
+                                                        true))
+                Names.push_back(PI->getPassArgument());
+        }
+    };
+}
+
+std::string llvm::getAnalysisOptionsKey(const Pass &P) {
+    // The registry is a map on pass IDs, so sort the names
+    AliasAnalysisLister AAs(P);
+    AAs.enumeratePasses();
+    std::sort(AAs.Names.begin(), AAs.Names.end());
+
+    std::string Key;
+    raw_string_ostream OS(Key);
+    OS << "pair-engine=" << (unsigned)PairEngine
+       << " loop-distance=" << (bool)LoopDistancePruning
+       << " exact-hitting-set=" << (bool)ExactHittingSetMode
+       << " profile-weights=" << (bool)ProfileWeightedCuts
+       << " cut-priority=" << (unsigned)CutPriorityPolicy
+       << " reduce-paths=" << (bool)ReducePaths
+       << " incremental-cuts=" << (bool)IncrementalCuts
+       << " min-pair-count=" << (unsigned)MinPairCount
+       << " pair-percentile=" << (unsigned)PairCountPercentile
+       << " pair-count-weights=" << (bool)PairCountWeightedCuts;
+    if (ExactHittingSetMode)
+        OS << " exact-budget-ms=" << (unsigned)ExactBudgetMS;
+    OS << " aa=";
+    for (unsigned i = 0, e = AAs.Names.size(); i != e; ++i)
+        OS << AAs.Names[i] << ",";
+    return OS.str();
+}
@@ -0,0 +1,117 @@
+//===-------- IdemOptions.h - Shared idenRegion options -----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Command line options shared by the idenRegion passes.  All passes are built
+// into the same loadable module, so every option is defined exactly once in
+// IdemOptions.cpp and only declared here.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_IDEMOPTIONS_H
+#define IDENREGION_IDEMOPTIONS_H
+
+#include "llvm/Support/CommandLine.h"
+#include <string>
+
+namespace llvm {
+
+// How antidependence pairs are discovered.
+enum PairEngineTy {
+    DFSPairs,          // one reverse DFS per store
+    DataflowPairs,     // one backward bitvector dataflow per function
+    CrossCheckPairs    // run both, keep the DFS result, report differences
+};
+extern cl::opt<PairEngineTy> PairEngine;
+
+// How the greedy hitting set is computed.  All engines pick the same cuts.
+enum HittingSetEngineTy {
+    HeapCover,         // indexed max-heap with decrease-key
+    BitsetCover,       // bit rows with SIMD popcount, lazy rescoring
+    ArenaCover         // CSR sets in one arena (hittingSet.cpp)
+};
+extern cl::opt<HittingSetEngineTy> HittingSetEngine;
+
+// Drop duplicate and subsumed paths before solving the hitting set.
+extern cl::opt<bool> ReducePaths;
+
+// How the greedy hitting set ranks cut candidates.
+enum CutPriorityTy {
+    PathCountCuts,     // most unhit paths first
+    LoopDepthCuts      // outer loops first (MemoryIdempotenceAnalysis)
+};
+extern cl::opt<CutPriorityTy> CutPriorityPolicy;
+
+// Search for a minimum hitting set instead of taking the greedy one, giving
+// up after ExactBudgetMS milliseconds per function (0 = no limit).
+extern cl::opt<bool> ExactHittingSetMode;
+extern cl::opt<unsigned> ExactBudgetMS;
+
+// Repair the cached cut set of an unchanged function body when only its
+// profiled pairs changed, instead of solving again (idenRegion-dynamic, plain
+// greedy hitting set only).
+extern cl::opt<bool> IncrementalCuts;
+
+// Weight the greedy hitting set by the loaded profile (ProfileInfo), placing
+// cuts in cold code.  Ignored by the exact search.
+extern cl::opt<bool> ProfileWeightedCuts;
+
+// Merged profile (IdemProfile.h) to take those block counts from instead of
+// ProfileInfo; empty means ProfileInfo.  idenRegion-dynamic also takes its
+// profiled dependences from it instead of LAMP's own output.
+extern cl::opt<std::string> MergedProfileFile;
+
+// Which profiled (load, store) pairs idenRegion-dynamic trusts in place of
+// the static pair search of their store: pairs seen at least MinPairCount
+// times, and among the hottest pairs that make up PairCountPercentile percent
+// of the profile's observations.  The others are left to the static search.
+extern cl::opt<unsigned> MinPairCount;
+extern cl::opt<unsigned> PairCountPercentile;
+
+// Weight each path of idenRegion-dynamic's greedy hitting set by how often
+// the profile saw its pair, so the cuts that hit the hottest antidependences
+// are taken first.  Cuts cost their block count under -idem-profile-weights
+// and all the same otherwise.  Ignored by the exact search.
+extern cl::opt<bool> PairCountWeightedCuts;
+
+// File to which idenRegion-static writes the loads, stores and loops that
+// LAMP has to instrument for idenRegion-dynamic (ProfileFilter.h); empty
+// means none is written.
+extern cl::opt<std::string> LAMPFilterFile;
+
+// Worker threads used by idenRegion-module; 0 means one per online CPU.
+extern cl::opt<unsigned> AnalysisThreads;
+
+// How much the passes print to errs().
+enum VerbosityTy {
+    QuietOutput,       // nothing
+    SummaryOutput,     // per-function results and statistics
+    TraceOutput        // every pair, path and intermediate map
+};
+extern cl::opt<VerbosityTy> Verbosity;
+
+inline bool isVerbose(VerbosityTy Level) { return Verbosity >= Level; }
+
+// Use ScalarEvolution to drop pairs of affine loop accesses that never
+// overlap.
+extern cl::opt<bool> LoopDistancePruning;
+
+// On-disk cut set cache; an empty directory disables it.
+extern cl::opt<std::string> CutCacheDir;
+extern cl::opt<unsigned> CutCacheMaxMB;
+
+class Pass;
+
+// The values of every option that changes the pairs, paths or hitting set
+// computed for a function, and the alias analyses running for pass P.  Part
+// of the cut set cache key.
+std::string getAnalysisOptionsKey(const Pass &P);
+
+} // End llvm namespace
+
+#endif
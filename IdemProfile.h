@@ -0,0 +1,213 @@
+//===------- IdemProfile.h - Merged binary profile format ---------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the binary profile that tools/mergeProfiles writes from
+// any number of weighted runs: the edge counts of llvmprof.out and the LAMP
+// dependence counts, in one file that is read by mapping it, with no parsing
+// and no copy.  Version 1 is laid out as follows, little-endian and
+// naturally aligned:
+//
+//   IdemProfileHeader
+//   double EdgeCounts[NumEdges]     in llvmprof.out edge order; -1 where no
+//                                   run counted the edge, like
+//                                   ProfileInfo::MissingValue
+//   DepCountRecord Deps[NumDeps]    sorted by (Load, Store), no repeats
+//
+// Counts are the weighted sums over the runs, so they need not be integers.
+// Instructions are named by the ids LAMP's -lamp-insts numbering gives them.
+// The idenRegion passes read the edge counts with -idem-profile-file
+// (MergedBlockCounts in AntiDepAnalysis.h), and idenRegion-dynamic reads the
+// dependence records, mapping the ids back through LAMPLoadProfile.
+//
+// Like HittingSet.h this knows nothing about LLVM, so the tools can use it
+// without linking against it.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_IDEMPROFILE_H
+#define IDENREGION_IDEMPROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace llvm {
+
+struct IdemProfileHeader {
+    char Magic[8];              // "IDEMPROF"
+    uint32_t Version;
+    uint32_t NumRuns;           // runs merged into the file
+    double TotalWeight;         // sum of their weights
+    uint64_t NumEdges, EdgeOffset;
+    uint64_t NumDeps, DepOffset;
+};
+
+struct DepCountRecord {
+    uint32_t Load, Store;
+    double Count;
+
+    bool operator<(const DepCountRecord &R) const {
+        return Load != R.Load ? Load < R.Load : Store < R.Store;
+    }
+};
+
+enum { IdemProfileVersion = 1 };
+
+// A read-only view of a profile in memory, usually a mapped file.
+class IdemProfile {
+ public:
+    IdemProfile()
+        : Header_(0), Edges_(0), Deps_(0), Map_(0), MapSize_(0) {}
+    ~IdemProfile() { unmap(); }
+
+    // View the profile at Data, which must stay valid and be 8-byte
+    // aligned.  Returns false with a message if it is not a profile.
+    bool init(const void *Data, size_t Size, std::string &Error) {
+        const char *Base = static_cast<const char *>(Data);
+        const IdemProfileHeader *H =
+            reinterpret_cast<const IdemProfileHeader *>(Base);
+        if (Size < sizeof(IdemProfileHeader) ||
+            memcmp(H->Magic, "IDEMPROF", 8)) {
+            Error = "not an idenRegion profile";
+            return false;
+        }
+        if (H->Version != IdemProfileVersion) {
+            Error = "unsupported profile version";
+            return false;
+        }
+        if (!fits(H->EdgeOffset, H->NumEdges, sizeof(double), Size) ||
+            !fits(H->DepOffset, H->NumDeps, sizeof(DepCountRecord), Size) ||
+            H->EdgeOffset % 8 || H->DepOffset % 8) {
+            Error = "truncated profile";
+            return false;
+        }
+        Header_ = H;
+        Edges_ = reinterpret_cast<const double *>(Base + H->EdgeOffset);
+        Deps_ = reinterpret_cast<const DepCountRecord *>(Base + H->DepOffset);
+        return true;
+    }
+
+    // Map the file at Path and view it.
+    bool map(const char *Path, std::string &Error) {
+        unmap();
+        int FD = open(Path, O_RDONLY);
+        struct stat St;
+        if (FD < 0 || fstat(FD, &St)) {
+            Error = std::string(Path) + ": " + strerror(errno);
+            if (FD >= 0)
+                close(FD);
+            return false;
+        }
+        MapSize_ = St.st_size;
+        Map_ = MapSize_ ? mmap(0, MapSize_, PROT_READ, MAP_PRIVATE, FD, 0)
+                        : MAP_FAILED;
+        close(FD);
+        if (Map_ == MAP_FAILED) {
+            Map_ = 0;
+            Error = std::string(Path) + ": cannot map";
+            return false;
+        }
+        if (!init(Map_, MapSize_, Error)) {
+            Error = std::string(Path) + ": " + Error;
+            unmap();
+            return false;
+        }
+        return true;
+    }
+
+    unsigned getNumRuns() const { return Header_->NumRuns; }
+    double getTotalWeight() const { return Header_->TotalWeight; }
+
+    size_t getNumEdges() const { return Header_->NumEdges; }
+    const double *getEdgeCounts() const { return Edges_; }
+
+    size_t getNumDeps() const { return Header_->NumDeps; }
+    const DepCountRecord *getDeps() const { return Deps_; }
+
+    // Weighted count of the dependence, 0 if no run saw it.
+    double getDepCount(uint32_t Load, uint32_t Store) const {
+        DepCountRecord Key = { Load, Store, 0 };
+        const DepCountRecord *End = Deps_ + Header_->NumDeps;
+        const DepCountRecord *I = std::lower_bound(Deps_, End, Key);
+        return I != End && I->Load == Load && I->Store == Store ? I->Count
+                                                                : 0;
+    }
+
+    // Write a profile of NumRuns runs to Path, to a temporary name first so
+    // that readers never map a partial file.  Deps must be sorted and free
+    // of repeats.
+    static bool write(const char *Path, unsigned NumRuns, double TotalWeight,
+                      const std::vector<double> &Edges,
+                      const std::vector<DepCountRecord> &Deps,
+                      std::string &Error) {
+        IdemProfileHeader H;
+        memset(&H, 0, sizeof(H));
+        memcpy(H.Magic, "IDEMPROF", 8);
+        H.Version = IdemProfileVersion;
+        H.NumRuns = NumRuns;
+        H.TotalWeight = TotalWeight;
+        H.NumEdges = Edges.size();
+        H.EdgeOffset = sizeof(H);
+        H.NumDeps = Deps.size();
+        H.DepOffset = H.EdgeOffset + Edges.size() * sizeof(double);
+
+        std::string Tmp = std::string(Path) + ".tmp";
+        FILE *Out = fopen(Tmp.c_str(), "wb");
+        bool OK = Out && fwrite(&H, sizeof(H), 1, Out) == 1 &&
+                  (Edges.empty() ||
+                   fwrite(&Edges[0], sizeof(double), Edges.size(), Out) ==
+                       Edges.size()) &&
+                  (Deps.empty() ||
+                   fwrite(&Deps[0], sizeof(DepCountRecord), Deps.size(),
+                          Out) == Deps.size());
+        if (Out && fclose(Out))
+            OK = false;
+        if (!OK || rename(Tmp.c_str(), Path)) {
+            Error = std::string(Path) + ": " + strerror(errno);
+            remove(Tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+ private:
+    const IdemProfileHeader *Header_;
+    const double *Edges_;
+    const DepCountRecord *Deps_;
+    void *Map_;
+    size_t MapSize_;
+
+    IdemProfile(const IdemProfile &);           // not copyable
+    void operator=(const IdemProfile &);
+
+    static bool fits(uint64_t Offset, uint64_t N, size_t Elt, size_t Size) {
+        return Offset <= Size && N <= (Size - Offset) / Elt;
+    }
+
+    void unmap() {
+        if (Map_)
+            munmap(Map_, MapSize_);
+        Map_ = 0;
+        MapSize_ = 0;
+        Header_ = 0;
+    }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,184 @@
+//===---- IncrementalHittingSet.h - Repairable hitting set --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a hitting set that is kept up to date as paths come
+// and go, for when a function is analyzed again with mostly the same paths
+// (e.g. under a refined profile).  Instead of solving from scratch, the last
+// cut set is loaded together with the last paths, the differences are
+// applied, and repair():
+//
+//   - hits the paths left unhit with the greedy rule of GreedyHittingSet,
+//     run on those paths only
+//   - drops cuts every path of which another cut also hits, cuts on the
+//     fewest paths first
+//
+// The state is the number of cuts on each path, updated as cuts and paths
+// change.  Only paths added unhit are solved again and only cuts that lost a
+// path or share a path with a new cut are checked for redundancy, so a
+// repair costs time in the size of what changed, not of the whole function.
+// Pinned cuts (e.g. forced at calls) hit their paths but are never dropped.
+//
+// Like GreedyHittingSet.h this knows nothing about LLVM; candidates are
+// dense ids.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_INCREMENTALHITTINGSET_H
+#define IDENREGION_INCREMENTALHITTINGSET_H
+
+#include "GreedyHittingSet.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace llvm {
+
+class IncrementalHittingSet {
+ public:
+    explicit IncrementalHittingSet(unsigned NumCandidates)
+        : PathsOf_(NumCandidates), Cut_(NumCandidates, NoCut),
+          Touched_(NumCandidates, false), NumAdded_(0), NumDropped_(0) {}
+
+    // Add a path through the candidates [Begin, End) and return its handle.
+    // Repeated candidates count once.
+    template <typename IterT>
+    unsigned addPath(IterT Begin, IterT End) {
+        unsigned P = Paths_.size();
+        Paths_.push_back(std::vector<unsigned>(Begin, End));
+        std::vector<unsigned> &Path = Paths_.back();
+        std::sort(Path.begin(), Path.end());
+        Path.erase(std::unique(Path.begin(), Path.end()), Path.end());
+        HitBy_.push_back(0);
+        Live_.push_back(true);
+        for (unsigned j = 0, je = Path.size(); j != je; ++j) {
+            PathsOf_[Path[j]].push_back(P);
+            if (Cut_[Path[j]] != NoCut)
+                ++HitBy_[P];
+        }
+        if (HitBy_[P] == 0)
+            Unhit_.push_back(P);
+        return P;
+    }
+
+    // Remove path P; the cuts on it may become redundant.
+    void removePath(unsigned P) {
+        if (!Live_[P])
+            return;
+        Live_[P] = false;
+        const std::vector<unsigned> &Path = Paths_[P];
+        for (unsigned j = 0, je = Path.size(); j != je; ++j) {
+            std::vector<unsigned> &Of = PathsOf_[Path[j]];
+            Of.erase(std::find(Of.begin(), Of.end(), P));
+            touch(Path[j]);
+        }
+    }
+
+    // Take candidate C.  A pinned cut is never dropped by repair().  A saved
+    // solution is loaded by adding its cuts before its paths, which leaves
+    // nothing for repair() to check.
+    void addCut(unsigned C, bool Pinned = false) {
+        if (Cut_[C] == NoCut) {
+            Cut_[C] = DroppableCut;
+            for (unsigned i = 0, e = PathsOf_[C].size(); i != e; ++i) {
+                unsigned P = PathsOf_[C][i];
+                // The other cuts on a path hit twice may now be redundant.
+                if (++HitBy_[P] == 2)
+                    for (unsigned j = 0, je = Paths_[P].size(); j != je; ++j)
+                        touch(Paths_[P][j]);
+            }
+        }
+        if (Pinned)
+            Cut_[C] = PinnedCut;
+    }
+
+    // Hit every live path that has a candidate, then drop the cuts whose
+    // paths are all hit by other cuts.
+    void repair() {
+        GreedyHittingSet Greedy(PathsOf_.size());
+        for (unsigned i = 0, e = Unhit_.size(); i != e; ++i) {
+            unsigned P = Unhit_[i];
+            if (Live_[P] && HitBy_[P] == 0)
+                Greedy.addPath(Paths_[P].begin(), Paths_[P].end());
+        }
+        Unhit_.clear();
+        std::vector<unsigned> Picks;
+        Greedy.solve(Picks);
+        for (unsigned i = 0, e = Picks.size(); i != e; ++i)
+            addCut(Picks[i]);
+        NumAdded_ = Picks.size();
+
+        // Cuts on the fewest paths go first, then by id.
+        std::vector<std::pair<unsigned, unsigned> > Order;
+        for (unsigned i = 0, e = TouchList_.size(); i != e; ++i) {
+            unsigned C = TouchList_[i];
+            Touched_[C] = false;
+            if (Cut_[C] == DroppableCut)
+                Order.push_back(std::make_pair(PathsOf_[C].size(), C));
+        }
+        TouchList_.clear();
+        std::sort(Order.begin(), Order.end());
+        NumDropped_ = 0;
+        for (unsigned i = 0, e = Order.size(); i != e; ++i)
+            if (isRedundant(Order[i].second)) {
+                dropCut(Order[i].second);
+                ++NumDropped_;
+            }
+    }
+
+    bool isCut(unsigned C) const { return Cut_[C] != NoCut; }
+
+    // Append the cuts to Cuts, pinned ones included, by increasing id.
+    void getCuts(std::vector<unsigned> &Cuts) const {
+        for (unsigned C = 0, e = Cut_.size(); C != e; ++C)
+            if (Cut_[C] != NoCut)
+                Cuts.push_back(C);
+    }
+
+    // Cuts the last repair() added and dropped.
+    unsigned getNumAdded() const { return NumAdded_; }
+    unsigned getNumDropped() const { return NumDropped_; }
+
+ private:
+    enum { NoCut, DroppableCut, PinnedCut };
+
+    std::vector<std::vector<unsigned> > Paths_;     // path -> candidates
+    std::vector<std::vector<unsigned> > PathsOf_;   // candidate -> live paths
+    std::vector<unsigned> HitBy_;                   // cuts on each path
+    std::vector<bool> Live_;                        // not removed
+    std::vector<unsigned char> Cut_;                // NoCut, DroppableCut, ...
+    std::vector<unsigned> Unhit_;                   // paths added unhit
+    std::vector<bool> Touched_;                     // in TouchList_
+    std::vector<unsigned> TouchList_;               // cuts to check
+    unsigned NumAdded_, NumDropped_;
+
+    void touch(unsigned C) {
+        if (Cut_[C] != DroppableCut || Touched_[C])
+            return;
+        Touched_[C] = true;
+        TouchList_.push_back(C);
+    }
+
+    bool isRedundant(unsigned C) const {
+        for (unsigned i = 0, e = PathsOf_[C].size(); i != e; ++i)
+            if (HitBy_[PathsOf_[C][i]] < 2)
+                return false;
+        return true;
+    }
+
+    // Only called on redundant cuts, so every path stays hit.
+    void dropCut(unsigned C) {
+        Cut_[C] = NoCut;
+        for (unsigned i = 0, e = PathsOf_[C].size(); i != e; ++i)
+            --HitBy_[PathsOf_[C][i]];
+    }
+};
+
+} // End llvm namespace
+
+#endif
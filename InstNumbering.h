@@ -0,0 +1,93 @@
+//===-------- InstNumbering.h - Dense instruction numbering -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file numbers the blocks and instructions of a function in layout
+// order.  The numbers are stable for a given function body, so they can name
+// instructions outside of the current process (e.g. in the cut set cache).
+// The index also gives the "BB:offset" locator of an instruction without
+// walking its block.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_INSTNUMBERING_H
+#define IDENREGION_INSTNUMBERING_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instruction.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/Twine.h"
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+class InstNumbering {
+ public:
+    void build(Function &F) {
+        Insts_.clear();
+        Offsets_.clear();
+        Blocks_.clear();
+        InstIdx_.clear();
+        BlockIdx_.clear();
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+            BlockIdx_[BB] = Blocks_.size();
+            Blocks_.push_back(BB);
+            unsigned Offset = 1;
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+                 I != IE; ++I) {
+                InstIdx_[I] = Insts_.size();
+                Insts_.push_back(I);
+                Offsets_.push_back(Offset++);
+            }
+        }
+    }
+
+    unsigned getNumInsts() const  { return Insts_.size(); }
+    unsigned getNumBlocks() const { return Blocks_.size(); }
+
+    unsigned getIndex(const Instruction *I) const {
+        return InstIdx_.lookup(I);
+    }
+    unsigned getIndex(const BasicBlock *BB) const {
+        return BlockIdx_.lookup(BB);
+    }
+    Instruction *getInst(unsigned N) const  { return Insts_[N]; }
+    BasicBlock *getBlock(unsigned N) const  { return Blocks_[N]; }
+
+    // Position of I in its block, counting from 1.  Instructions of other
+    // functions are not indexed and fall back to a walk of their block.
+    unsigned getOffset(const Instruction *I) const {
+        DenseMap<const Instruction *, unsigned>::const_iterator It =
+            InstIdx_.find(I);
+        if (It != InstIdx_.end())
+            return Offsets_[It->second];
+
+        unsigned Offset = 1;
+        const BasicBlock *BB = I->getParent();
+        for (BasicBlock::const_iterator It = I; It != BB->begin(); --It)
+            ++Offset;
+        return Offset;
+    }
+
+    std::string getLocator(const Instruction &I) const {
+        return (I.getParent()->getName() + ":" + Twine(getOffset(&I))).str();
+    }
+
+ private:
+    std::vector<Instruction *> Insts_;
+    std::vector<unsigned> Offsets_;
+    std::vector<BasicBlock *> Blocks_;
+    DenseMap<const Instruction *, unsigned> InstIdx_;
+    DenseMap<const BasicBlock *, unsigned> BlockIdx_;
+};
+
+} // End llvm namespace
+
+#endif
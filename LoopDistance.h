@@ -0,0 +1,171 @@
+//===-------- LoopDistance.h - Affine loop access disambiguation --*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file proves that a load inside a loop never reads what a later store of
+// the same loop overwrites, using the affine address recurrences ScalarEvolution
+// computes for GEP-indexed accesses.  Loads and stores are any readers and
+// writers of constant size (see MemoryAccess.h).
+//
+// If both addresses are {Base,+,Step}<L> with the same constant Step and a
+// constant distance d = LoadBase - StoreBase, then a load executed t
+// iterations before the store reads [d - Step*t, d - Step*t + LoadSize)
+// relative to the stored bytes [0, StoreSize).  The pair is independent when
+// no t in range makes those intervals overlap.  The backward search from a
+// store only reaches loads of the same or earlier iterations (t >= 0) when L
+// is outermost; in a nested loop the inner recurrence restarts every outer
+// iteration, so both signs of t are possible and both are checked.  The range
+// is capped by the loop's maximum backedge-taken count when it is known.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_LOOPDISTANCE_H
+#define IDENREGION_LOOPDISTANCE_H
+
+#include "llvm/Instructions.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
+#include "llvm/Analysis/ScalarEvolutionExpressions.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetData.h"
+#include "MemoryAccess.h"
+#include <utility>
+
+namespace llvm {
+
+class LoopDistance {
+ public:
+    typedef std::pair<Instruction *, Instruction *> PairTy;
+
+    LoopDistance() : SE_(0), LI_(0), TD_(0), Queries_(0) {}
+
+    void reset(ScalarEvolution *SE, LoopInfo *LI, const TargetData *TD) {
+        SE_ = SE;
+        LI_ = LI;
+        TD_ = TD;
+        Queries_ = 0;
+        Pruned_.clear();
+        Seen_.clear();
+    }
+
+    // True if Load provably reads none of the bytes Store writes on any path
+    // from Load to Store.  Each proven pair is remembered for the report.
+    bool isIndependent(Instruction *Load, Instruction *Store) {
+        Value *LoadPtr, *StorePtr;
+        uint64_t LoadBytes, StoreBytes;
+        if (!SE_ || !TD_ || !getReadAccess(Load, TD_, LoadPtr, LoadBytes) ||
+            !getWriteAccess(Store, TD_, StorePtr, StoreBytes))
+            return false;
+        Loop *L = LI_->getLoopFor(Load->getParent());
+        if (!L || !L->contains(Store->getParent()))
+            return false;
+        ++Queries_;
+
+        // Both addresses must recur over one loop around both accesses.
+        const SCEVAddRecExpr *LoadRec = getAddRec(LoadPtr);
+        const SCEVAddRecExpr *StoreRec = getAddRec(StorePtr);
+        if (!LoadRec || !StoreRec || LoadRec->getLoop() != StoreRec->getLoop())
+            return false;
+        L = const_cast<Loop *>(LoadRec->getLoop());
+        if (!L->contains(Load->getParent()) || !L->contains(Store->getParent()))
+            return false;
+
+        const SCEVConstant *Step =
+            dyn_cast<SCEVConstant>(LoadRec->getStepRecurrence(*SE_));
+        if (!Step || Step != StoreRec->getStepRecurrence(*SE_))
+            return false;
+        const SCEVConstant *Dist = dyn_cast<SCEVConstant>(
+            SE_->getMinusSCEV(LoadRec->getStart(), StoreRec->getStart()));
+        if (!Dist)
+            return false;
+
+        // Bases that move with an outer loop change between outer iterations
+        // by an unknown amount.
+        Loop *Outermost = L;
+        while (Outermost->getParentLoop())
+            Outermost = Outermost->getParentLoop();
+        if (!SE_->isLoopInvariant(LoadRec->getStart(), Outermost) ||
+            !SE_->isLoopInvariant(StoreRec->getStart(), Outermost))
+            return false;
+
+        const APInt &S = Step->getValue()->getValue();
+        const APInt &D = Dist->getValue()->getValue();
+        // Sizes include UnknownSize for variable-length intrinsics.
+        if (S.getMinSignedBits() > 32 || D.getMinSignedBits() > 32 ||
+            LoadBytes > (1U << 31) || StoreBytes > (1U << 31))
+            return false;
+
+        int64_t MaxT = -1;   // unbounded
+        const SCEVConstant *Trip =
+            dyn_cast<SCEVConstant>(SE_->getMaxBackedgeTakenCount(L));
+        if (Trip && Trip->getValue()->getValue().getActiveBits() <= 32)
+            MaxT = Trip->getValue()->getZExtValue();
+
+        int64_t LoadSize = LoadBytes, StoreSize = StoreBytes;
+        int64_t MinT = 0;
+        if (L->getParentLoop())
+            MinT = MaxT < 0 ? -(int64_t(1) << 31) : -MaxT;
+        if (mayOverlap(D.getSExtValue(), S.getSExtValue(), LoadSize, StoreSize,
+                       MinT, MaxT))
+            return false;
+
+        if (Seen_.insert(PairTy(Load, Store)).second)
+            Pruned_.push_back(PairTy(Load, Store));
+        return true;
+    }
+
+    ArrayRef<PairTy> getPruned() const { return Pruned_; }
+
+    void print(raw_ostream &OS) const {
+        OS << "Loop distance: " << Pruned_.size() << " of " << Queries_
+           << " loop pairs proven independent\n";
+    }
+
+ private:
+    ScalarEvolution *SE_;
+    LoopInfo *LI_;
+    const TargetData *TD_;
+    unsigned Queries_;
+    SmallVector<PairTy, 16> Pruned_;
+    DenseSet<PairTy> Seen_;
+
+    const SCEVAddRecExpr *getAddRec(Value *Ptr) {
+        const SCEVAddRecExpr *Rec =
+            dyn_cast<SCEVAddRecExpr>(SE_->getSCEV(Ptr));
+        return Rec && Rec->isAffine() ? Rec : 0;
+    }
+
+    // Is there an integer t in [MinT, MaxT] (MaxT < 0: no upper bound) with
+    // -LoadSize < D - S*t < StoreSize?
+    static bool mayOverlap(int64_t D, int64_t S, int64_t LoadSize,
+                           int64_t StoreSize, int64_t MinT, int64_t MaxT) {
+        if (S == 0)
+            return -LoadSize < D && D < StoreSize;
+        // Make D - S*t decreasing in t by mirroring the byte axis.
+        if (S < 0) {
+            D = -D;
+            S = -S;
+            std::swap(LoadSize, StoreSize);
+        }
+        // First t whose difference drops below StoreSize.
+        int64_t Num = D - StoreSize;
+        int64_t T = (Num >= 0 ? Num / S : -((-Num + S - 1) / S)) + 1;
+        if (T < MinT)
+            T = MinT;
+        if (MaxT >= 0 && T > MaxT)
+            return false;
+        return D - S * T > -LoadSize;
+    }
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,93 @@
+//===-------- MemoryAccess.h - Byte ranges read and written -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file describes the memory an instruction reads or writes as a pointer
+// and a byte size, so that the antidependence search can treat every kind of
+// access alike.  Readers are loads and the source of memcpy/memmove; writers
+// are stores and the destination of memset/memcpy/memmove.  A memory
+// intrinsic with a non-constant length accesses UnknownSize bytes.
+//
+// Volatile and atomic accesses are neither readers nor writers here: they are
+// isolated by forced cuts (see FunctionSummaries) instead.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_MEMORYACCESS_H
+#define IDENREGION_MEMORYACCESS_H
+
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/IntrinsicInst.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Target/TargetData.h"
+
+namespace llvm {
+
+// Bytes a memory intrinsic touches, or UnknownSize.
+inline uint64_t getMemIntrinsicSize(const MemIntrinsic *MI) {
+    if (const ConstantInt *Len = dyn_cast<ConstantInt>(MI->getLength()))
+        return Len->getZExtValue();
+    return AliasAnalysis::UnknownSize;
+}
+
+inline uint64_t getStoreSize(const TargetData *TD, Type *Ty) {
+    return TD ? TD->getTypeStoreSize(Ty) : AliasAnalysis::UnknownSize;
+}
+
+inline bool isMemoryReader(const Instruction *I) {
+    if (const LoadInst *Load = dyn_cast<LoadInst>(I))
+        return Load->isUnordered();
+    if (const MemTransferInst *MTI = dyn_cast<MemTransferInst>(I))
+        return !MTI->isVolatile();
+    return false;
+}
+
+inline bool isMemoryWriter(const Instruction *I) {
+    if (const StoreInst *Store = dyn_cast<StoreInst>(I))
+        return Store->isUnordered();
+    if (const MemIntrinsic *MI = dyn_cast<MemIntrinsic>(I))
+        return !MI->isVolatile();
+    return false;
+}
+
+// The bytes reader I reads.  Returns false if I is not a reader.
+inline bool getReadAccess(Instruction *I, const TargetData *TD,
+                          Value *&Ptr, uint64_t &Size) {
+    if (!isMemoryReader(I))
+        return false;
+    if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
+        Ptr = Load->getPointerOperand();
+        Size = getStoreSize(TD, Load->getType());
+    } else {
+        MemTransferInst *MTI = cast<MemTransferInst>(I);
+        Ptr = MTI->getRawSource();
+        Size = getMemIntrinsicSize(MTI);
+    }
+    return true;
+}
+
+// The bytes writer I overwrites.  Returns false if I is not a writer.
+inline bool getWriteAccess(Instruction *I, const TargetData *TD,
+                           Value *&Ptr, uint64_t &Size) {
+    if (!isMemoryWriter(I))
+        return false;
+    if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+        Ptr = Store->getPointerOperand();
+        Size = getStoreSize(TD, Store->getValueOperand()->getType());
+    } else {
+        MemIntrinsic *MI = cast<MemIntrinsic>(I);
+        Ptr = MI->getRawDest();
+        Size = getMemIntrinsicSize(MI);
+    }
+    return true;
+}
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,156 @@
+//===-------- MemoryBuckets.h - Underlying-object bucketing -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file groups the readers and writers of a function (see MemoryAccess.h)
+// by the object they access before the antidependence pair search runs.
+// Every identified object (alloca, global, noalias call or argument) found by
+// GetUnderlyingObject gets its own bucket; everything else lands in the
+// Unknown bucket.  Two accesses in different identified buckets can never
+// alias, so the pair search only has to look at loads in the store's bucket
+// or the Unknown bucket, and can step over whole blocks that contain none.
+// Calls, and anything else that can end a search through FunctionSummaries
+// forced cuts, count as Unknown reads of their block.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_MEMORYBUCKETS_H
+#define IDENREGION_MEMORYBUCKETS_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/BitVector.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/ValueTracking.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetData.h"
+#include "MemoryAccess.h"
+
+namespace llvm {
+
+class MemoryBuckets {
+ public:
+    enum { Unknown = 0 };
+
+    MemoryBuckets() : TD_(0), NumBuckets_(1), SkippedBlocks_(0),
+                      SkippedLoads_(0) {}
+
+    // Bucket every load and store of F and record which buckets each block
+    // reads from.
+    void build(Function &F, const TargetData *TD) {
+        TD_ = TD;
+        PtrBucket_.clear();
+        ObjBucket_.clear();
+        BlockReads_.clear();
+        NumBuckets_ = 1;
+        SkippedBlocks_ = SkippedLoads_ = 0;
+
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+                 I != IE; ++I) {
+                Value *Ptr;
+                uint64_t Size;
+                if (getReadAccess(I, TD_, Ptr, Size))
+                    getBucket(Ptr);
+                if (getWriteAccess(I, TD_, Ptr, Size))
+                    getBucket(Ptr);
+            }
+
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB) {
+            BitVector &Reads = BlockReads_[BB];
+            Reads.resize(NumBuckets_);
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+                 I != IE; ++I) {
+                if (isa<LoadInst>(I) || isMemoryReader(I))
+                    Reads.set(getReadBucket(I));
+                else if (!isMemoryWriter(I) &&
+                         (I->mayReadFromMemory() || I->mayWriteToMemory()))
+                    Reads.set(Unknown);
+            }
+        }
+    }
+
+    // Bucket of the object Ptr points into.
+    unsigned getBucket(Value *Ptr) {
+        DenseMap<const Value *, unsigned>::iterator It = PtrBucket_.find(Ptr);
+        if (It != PtrBucket_.end())
+            return It->second;
+
+        unsigned Bucket = Unknown;
+        Value *Obj = GetUnderlyingObject(Ptr, TD_);
+        if (isIdentifiedObject(Obj)) {
+            unsigned &ObjBucket = ObjBucket_[Obj];
+            if (ObjBucket == Unknown)
+                ObjBucket = NumBuckets_++;
+            Bucket = ObjBucket;
+        }
+        PtrBucket_[Ptr] = Bucket;
+        return Bucket;
+    }
+
+    // Bucket of a reader.  Volatile and atomic loads conflict with every
+    // store (see AliasOracle), so they always count as Unknown.
+    unsigned getReadBucket(Instruction *Reader) {
+        Value *Ptr;
+        uint64_t Size;
+        if (!getReadAccess(Reader, TD_, Ptr, Size))
+            return Unknown;
+        return getBucket(Ptr);
+    }
+
+    // Accesses in buckets A and B may touch the same memory.
+    static bool compatible(unsigned A, unsigned B) {
+        return A == B || A == Unknown || B == Unknown;
+    }
+
+    // Can Reader read from memory in StoreBucket?
+    bool mayRead(Instruction *Reader, unsigned StoreBucket) {
+        if (compatible(getReadBucket(Reader), StoreBucket))
+            return true;
+        ++SkippedLoads_;
+        return false;
+    }
+
+    // Does BB contain any reader that can read from memory in StoreBucket?
+    bool blockMayRead(const BasicBlock *BB, unsigned StoreBucket) {
+        DenseMap<const BasicBlock *, BitVector>::const_iterator It =
+            BlockReads_.find(BB);
+        if (It == BlockReads_.end())
+            return true;
+        const BitVector &Reads = It->second;
+        bool MayRead = StoreBucket == Unknown ? Reads.any()
+                       : Reads.test(StoreBucket) || Reads.test(Unknown);
+        if (!MayRead)
+            ++SkippedBlocks_;
+        return MayRead;
+    }
+
+    unsigned getNumBuckets() const { return NumBuckets_; }
+
+    // Debugging support.
+    void print(raw_ostream &OS) const {
+        OS << "Memory buckets: " << NumBuckets_ - 1 << " objects + unknown, "
+           << SkippedBlocks_ << " blocks and " << SkippedLoads_
+           << " loads skipped\n";
+    }
+
+ private:
+    const TargetData *TD_;
+    DenseMap<const Value *, unsigned> PtrBucket_;
+    DenseMap<const Value *, unsigned> ObjBucket_;
+    DenseMap<const BasicBlock *, BitVector> BlockReads_;
+    unsigned NumBuckets_;
+    unsigned SkippedBlocks_;
+    unsigned SkippedLoads_;
+};
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,110 @@
+//===-------- PairCounts.h - Profiled pair frequency policy -------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains what idenRegion-dynamic does with the number of times
+// the LAMP profile saw each (load, store) pair:
+//
+//   - which pairs it trusts in place of the static search of their store
+//     (-idem-min-pair-count, -idem-pair-percentile); the percentile is turned
+//     into a count once per module, so a pair is trusted or not regardless of
+//     the function it is in
+//   - how much the path of each trusted pair weighs in the hitting set
+//     (-idem-pair-count-weights): one more than the times it was seen
+//   - the estimated dynamic behavior of the resulting cuts, summed over the
+//     module, so that settings can be compared on the same inputs
+//
+// A cut is estimated to run as often as its block, so the cut executions and
+// the region length need the block counts (-idem-profile-weights) and are only
+// reported with them.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_PAIRCOUNTS_H
+#define IDENREGION_PAIRCOUNTS_H
+
+#include "llvm/Support/DataTypes.h"
+#include "llvm/Support/raw_ostream.h"
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace llvm {
+
+// The smallest count among the hottest pairs that make up Percent percent
+// of all observations; pairs with the same count are all in or all out.
+// Everything is in at 100 percent and nothing at 0.
+inline uint64_t getPercentileCount(std::vector<uint64_t> Counts,
+                                   unsigned Percent) {
+    if (Percent >= 100 || Counts.empty())
+        return 0;
+    if (Percent == 0)
+        return ~(uint64_t)0;
+    std::sort(Counts.begin(), Counts.end(), std::greater<uint64_t>());
+    double Total = 0;
+    for (unsigned i = 0, e = Counts.size(); i != e; ++i)
+        Total += Counts[i];
+    double Target = Total * Percent / 100, Sum = 0;
+    for (unsigned i = 0, e = Counts.size(); i != e; ++i) {
+        Sum += Counts[i];
+        if (Sum >= Target)
+            return Counts[i];
+    }
+    return Counts.back();
+}
+
+struct DynamicRegionReport {
+    unsigned Pairs, Trusted;            // profiled pairs valid in the code
+    uint64_t Observations;              // times the profile saw them
+    uint64_t TrustedObservations;
+    bool Estimated;                     // block counts were available
+    double CutExecutions;               // estimated region boundaries
+    double Instructions;                // estimated dynamic instructions
+
+    DynamicRegionReport()
+        : Pairs(0), Trusted(0), Observations(0), TrustedObservations(0),
+          Estimated(false), CutExecutions(0), Instructions(0) {}
+
+    void addPair(uint64_t Count, bool IsTrusted) {
+        ++Pairs;
+        Observations += Count;
+        if (IsTrusted) {
+            ++Trusted;
+            TrustedObservations += Count;
+        }
+    }
+
+    void add(const DynamicRegionReport &R) {
+        Pairs += R.Pairs;
+        Trusted += R.Trusted;
+        Observations += R.Observations;
+        TrustedObservations += R.TrustedObservations;
+        Estimated |= R.Estimated;
+        CutExecutions += R.CutExecutions;
+        Instructions += R.Instructions;
+    }
+
+    // Dynamic instructions per region boundary.
+    double getRegionLength() const {
+        return Instructions / (CutExecutions ? CutExecutions : 1);
+    }
+
+    void print(raw_ostream &OS) const {
+        OS << "Profiled pairs: " << Trusted << " of " << Pairs
+           << " trusted (" << TrustedObservations << " of " << Observations
+           << " observations)";
+        if (Estimated)
+            OS << ", " << CutExecutions << " estimated cut executions, region "
+               << "length " << getRegionLength();
+        OS << "\n";
+    }
+};
+
+} // End llvm namespace
+
+#endif
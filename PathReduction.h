@@ -0,0 +1,133 @@
+//===---------- PathReduction.h - Drop redundant cut paths --------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the reduction run on the antidependence paths before
+// the hitting set is solved.  A cut that hits a path hits every path that
+// contains it, so of two paths where one is a subset of the other only the
+// smaller one matters; and repeated pairs produce duplicate paths.
+//
+// Paths are taken as sets of dense candidate ids and visited shortest first.
+// Duplicates are found by hashing the sorted ids.  A path Q is subsumed by a
+// kept path P if P's smallest id is on Q, P's 64-bit signature (one bit per
+// id modulo 64) has no bit Q's lacks, and every id of P is marked in Q's
+// membership bitmap.  Of duplicates, and of paths equal as sets, the first
+// one in the input is kept, so the result is deterministic and the order of
+// the survivors is unchanged.
+//
+// Like GreedyHittingSet.h this knows nothing about LLVM; AntiDepAnalysis.h
+// applies it to instruction paths.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_PATHREDUCTION_H
+#define IDENREGION_PATHREDUCTION_H
+
+#include <stdint.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace llvm {
+
+struct PathReductionStats {
+    unsigned Paths;         // paths given
+    unsigned Duplicates;    // dropped as copies of a kept path
+    unsigned Subsumed;      // dropped as supersets of a kept path
+
+    PathReductionStats() : Paths(0), Duplicates(0), Subsumed(0) {}
+    unsigned getKept() const { return Paths - Duplicates - Subsumed; }
+};
+
+// Order of path indices: shorter sets first, then input order.
+struct ShorterPathFirst {
+    const std::vector<std::vector<unsigned> > &Sets;
+    explicit ShorterPathFirst(const std::vector<std::vector<unsigned> > &S)
+        : Sets(S) {}
+    bool operator()(unsigned A, unsigned B) const {
+        if (Sets[A].size() != Sets[B].size())
+            return Sets[A].size() < Sets[B].size();
+        return A < B;
+    }
+};
+
+// Set Keep[i] for every path of Paths (candidate ids below NumCandidates)
+// that is neither a duplicate nor a superset of another path.
+inline void reducePaths(const std::vector<std::vector<unsigned> > &Paths,
+                        unsigned NumCandidates, std::vector<char> &Keep,
+                        PathReductionStats &Stats) {
+    unsigned N = Paths.size();
+    std::vector<std::vector<unsigned> > Sets(Paths);
+    std::vector<uint64_t> Signature(N, 0), Hash(N, 0);
+    std::vector<unsigned> Order(N);
+    for (unsigned i = 0; i != N; ++i) {
+        std::vector<unsigned> &S = Sets[i];
+        std::sort(S.begin(), S.end());
+        S.erase(std::unique(S.begin(), S.end()), S.end());
+        uint64_t H = 14695981039346656037ULL;   // FNV-1a
+        for (unsigned j = 0, je = S.size(); j != je; ++j) {
+            Signature[i] |= uint64_t(1) << (S[j] % 64);
+            H = (H ^ S[j]) * 1099511628211ULL;
+        }
+        Hash[i] = H;
+        Order[i] = i;
+    }
+    std::sort(Order.begin(), Order.end(), ShorterPathFirst(Sets));
+
+    Keep.assign(N, 0);
+    Stats.Paths += N;
+    std::map<uint64_t, std::vector<unsigned> > ByHash;
+    std::vector<std::vector<unsigned> > ByMin(NumCandidates);
+    std::vector<unsigned> Mark(NumCandidates, ~0U);
+    for (unsigned o = 0; o != N; ++o) {
+        unsigned Q = Order[o];
+        const std::vector<unsigned> &QS = Sets[Q];
+
+        std::vector<unsigned> &Same = ByHash[Hash[Q]];
+        bool Duplicate = false;
+        for (unsigned k = 0, ke = Same.size(); k != ke && !Duplicate; ++k)
+            Duplicate = Sets[Same[k]] == QS;
+        if (Duplicate) {
+            ++Stats.Duplicates;
+            continue;
+        }
+
+        for (unsigned j = 0, je = QS.size(); j != je; ++j)
+            Mark[QS[j]] = Q;
+        bool Subsumed = false;
+        for (unsigned j = 0, je = QS.size(); j != je && !Subsumed; ++j) {
+            const std::vector<unsigned> &Starts = ByMin[QS[j]];
+            for (unsigned k = 0, ke = Starts.size(); k != ke; ++k) {
+                unsigned P = Starts[k];
+                if (Signature[P] & ~Signature[Q])
+                    continue;
+                const std::vector<unsigned> &PS = Sets[P];
+                unsigned m = 1, me = PS.size();
+                while (m != me && Mark[PS[m]] == Q)
+                    ++m;
+                if (m == me) {
+                    Subsumed = true;
+                    break;
+                }
+            }
+        }
+        if (Subsumed) {
+            ++Stats.Subsumed;
+            continue;
+        }
+
+        Keep[Q] = 1;
+        Same.push_back(Q);
+        if (!QS.empty())
+            ByMin[QS[0]].push_back(Q);
+    }
+}
+
+} // End llvm namespace
+
+#endif
@@ -0,0 +1,204 @@
+//===------ PriorityHittingSet.h - Hitting set by cut priority ----*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains a greedy hitting set whose ranking of cut candidates is
+// pluggable.  A CutPriority maps what is known about a candidate (its loop
+// depth, whether it is an antidependent store or sits in a subloop preheader,
+// how many paths it hits) to a 64-bit priority, and the candidate with the
+// highest priority is cut first.
+//
+// Two policies are provided:
+//
+//   - PathCountPriority: most unhit paths first, i.e. the plain greedy
+//     heuristic (same picks as GreedyHittingSet)
+//   - LoopDepthPriority: the ranking of MemoryIdempotenceAnalysis (ref/),
+//     which moves cuts out of inner loops before counting paths
+//
+// As in MemoryIdempotenceAnalysis, candidates live in a worklist sorted by
+// priority with the best at the back.  When a cut hits a path, every other
+// candidate on the path changes priority and is moved to its new place with
+// a binary search and a rotate, so the list never has to be re-sorted.  Ties
+// go to the candidate that appears first on the paths.
+//
+// Only LLVM headers are used, so idemcut (CUT/) can include it directly.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_PRIORITYHITTINGSET_H
+#define IDENREGION_PRIORITYHITTINGSET_H
+
+#include "llvm/BasicBlock.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/DataTypes.h"
+#include <algorithm>
+#include <vector>
+
+namespace llvm {
+
+// What a priority function may look at for one cut candidate.
+struct CutCandidate {
+    Instruction *Inst;
+    unsigned LoopDepth;
+    bool IsSubloopPreheader;    // in the preheader of a subloop of its loop
+    bool IsAntidependentStore;  // the store of some pair
+    unsigned Unintersected;     // paths no cut hits yet
+    unsigned Intersected;       // paths other cuts already hit
+    uint64_t Priority;          // cached CutPriority::get()
+};
+
+// Ranks cut candidates; higher is cut first.  Taking a cut only ever moves
+// other candidates' paths from unintersected to intersected.
+class CutPriority {
+ public:
+    virtual ~CutPriority() {}
+    virtual uint64_t get(const CutCandidate &C) const = 0;
+};
+
+// Most unhit paths first.
+class PathCountPriority : public CutPriority {
+ public:
+    virtual uint64_t get(const CutCandidate &C) const {
+        return C.Unintersected;
+    }
+};
+
+// The packed priority of MemoryIdempotenceAnalysis, from most to least
+// important: outer loops, more unhit paths, antidependent stores, subloop
+// preheaders, more already hit paths.  Counts saturate at their field width.
+class LoopDepthPriority : public CutPriority {
+ public:
+    virtual uint64_t get(const CutCandidate &C) const {
+        return (uint64_t)(0xFFFF - saturate(C.LoopDepth, 0xFFFF)) << 48 |
+               (uint64_t)saturate(C.Unintersected, 0xFFFF) << 32 |
+               (uint64_t)C.IsAntidependentStore << 24 |
+               (uint64_t)C.IsSubloopPreheader << 16 |
+               (uint64_t)saturate(C.Intersected, 0xFFFF);
+    }
+
+ private:
+    static unsigned saturate(unsigned V, unsigned Max) {
+        return V < Max ? V : Max;
+    }
+};
+
+inline bool isSubloopPreheader(const BasicBlock *BB,
+                               const LoopInfoBase<BasicBlock, Loop> &LI) {
+    if (Loop *L = LI.getLoopFor(BB))
+        for (Loop::iterator I = L->begin(), E = L->end(); I != E; ++I)
+            if (BB == (*I)->getLoopPreheader())
+                return true;
+    return false;
+}
+
+// Worklist order over candidate ids: is A cut after B?  Ids are in order of
+// first appearance, and the lower one wins a tie.
+struct CutCandidateLater {
+    const std::vector<CutCandidate> &Cands;
+    explicit CutCandidateLater(const std::vector<CutCandidate> &C)
+        : Cands(C) {}
+    bool operator()(unsigned A, unsigned B) const {
+        if (Cands[A].Priority != Cands[B].Priority)
+            return Cands[A].Priority < Cands[B].Priority;
+        return A > B;
+    }
+};
+
+// Insert into HittingSet a cut on every path of Paths, taking candidates in
+// the order Priority ranks them.
+template <typename PathListT, typename SetT>
+void computePriorityHittingSet(const PathListT &Paths,
+                               const LoopInfoBase<BasicBlock, Loop> &LI,
+                               const CutPriority &Priority,
+                               SetT &HittingSet) {
+    typedef std::vector<unsigned>::iterator PosTy;
+    std::vector<CutCandidate> Cands;
+    std::vector<std::vector<unsigned> > OnPath(Paths.size()), PathsOf;
+    DenseMap<Instruction *, unsigned> IdOf;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        for (unsigned j = 0, je = Paths[i].size(); j != je; ++j) {
+            Instruction *I = Paths[i][j];
+            std::pair<DenseMap<Instruction *, unsigned>::iterator, bool> It =
+                IdOf.insert(std::make_pair(I, Cands.size()));
+            unsigned Id = It.first->second;
+            if (It.second) {
+                CutCandidate C;
+                C.Inst = I;
+                C.LoopDepth = LI.getLoopDepth(I->getParent());
+                C.IsSubloopPreheader = isSubloopPreheader(I->getParent(), LI);
+                C.IsAntidependentStore = false;
+                C.Unintersected = C.Intersected = 0;
+                Cands.push_back(C);
+                PathsOf.push_back(std::vector<unsigned>());
+            }
+            // Antidependent stores are always first on their path.
+            if (j == 0)
+                Cands[Id].IsAntidependentStore = true;
+            if (!PathsOf[Id].empty() && PathsOf[Id].back() == i)
+                continue;
+            OnPath[i].push_back(Id);
+            PathsOf[Id].push_back(i);
+            ++Cands[Id].Unintersected;
+        }
+
+    // The highest priority candidate is at the back.
+    CutCandidateLater Later(Cands);
+    std::vector<unsigned> Worklist;
+    for (unsigned Id = 0, e = Cands.size(); Id != e; ++Id) {
+        Cands[Id].Priority = Priority.get(Cands[Id]);
+        Worklist.push_back(Id);
+    }
+    std::sort(Worklist.begin(), Worklist.end(), Later);
+
+    std::vector<char> Listed(Cands.size(), 1), Hit(Paths.size(), 0);
+    while (!Worklist.empty()) {
+        unsigned Id = Worklist.back();
+        Worklist.pop_back();
+        Listed[Id] = 0;
+        if (Cands[Id].Unintersected == 0)
+            continue;
+        HittingSet.insert(Cands[Id].Inst);
+
+        // The other candidates on the newly hit paths lose an unhit path.
+        for (unsigned p = 0, pe = PathsOf[Id].size(); p != pe; ++p) {
+            unsigned P = PathsOf[Id][p];
+            if (Hit[P])
+                continue;
+            Hit[P] = 1;
+            for (unsigned o = 0, oe = OnPath[P].size(); o != oe; ++o) {
+                unsigned Other = OnPath[P][o];
+                if (!Listed[Other])
+                    continue;
+                PosTy Old = std::lower_bound(Worklist.begin(), Worklist.end(),
+                                             Other, Later);
+                uint64_t OldPriority = Cands[Other].Priority;
+                --Cands[Other].Unintersected;
+                ++Cands[Other].Intersected;
+                Cands[Other].Priority = Priority.get(Cands[Other]);
+
+                // Re-insert by rotation, toward the front when the priority
+                // dropped, as it does unless a count saturated.
+                if (Cands[Other].Priority <= OldPriority) {
+                    PosTy New = std::lower_bound(Worklist.begin(), Old, Other,
+                                                 Later);
+                    std::rotate(New, Old, Old + 1);
+                } else {
+                    PosTy New = std::lower_bound(Old + 1, Worklist.end(),
+                                                 Other, Later);
+                    std::rotate(Old, Old + 1, New);
+                }
+            }
+        }
+    }
+}
+
+} // End llvm namespace
+
+#endif
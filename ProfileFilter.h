@@ -0,0 +1,139 @@
+//===-------- ProfileFilter.h - Operations worth LAMP profiling ---*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the list of memory operations that LAMP has to watch for
+// idenRegion-dynamic (-idem-lamp-filter).  The dynamic pass only uses
+// profiled (load, store) pairs of plain loads and stores in the same
+// function, and the profile can only see a pair whose accesses may alias.  So
+// a load or store without a may-alias partner of the other kind in its
+// function never shows up in a pair it uses, and leaving it uninstrumented
+// does not change the dynamic pairs.  The loops around the remaining
+// operations keep their iteration hooks, so loop-carried dependences are
+// still told apart.
+//
+// The list is a text file, one line per operation or loop:
+//
+//   <function> load <id> <locator>
+//   <function> store <id> <locator>
+//   <function> loop <header name>
+//
+// with loads and stores named by the ids -lamp-insts gives them, as
+// LAMPLoadProfile's InstToIdMap has them for the bitcode the list was
+// written for, and loops by their header block.  The locator is only there
+// for the reader.  An operation LAMP gave no id is not profiled anyway and is
+// left out; functions without any kept operation have no lines.
+//
+// LAMP in this tree still instruments every load and store, so the list only
+// says what a run could skip; nothing reads it yet.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef IDENREGION_PROFILEFILTER_H
+#define IDENREGION_PROFILEFILTER_H
+
+#include "llvm/Function.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetData.h"
+#include "AliasOracle.h"
+#include "InstNumbering.h"
+#include "MemoryAccess.h"
+#include "MemoryBuckets.h"
+#include <map>
+
+namespace llvm {
+
+class ProfileFilter {
+ public:
+    ProfileFilter() : Ops_(0), Kept_(0), Loops_(0) {}
+
+    // Append the operations of F that LAMP has to watch to OS.  Oracle and
+    // Buckets must be set up for F.
+    void addFunction(Function &F, AliasOracle &Oracle, MemoryBuckets &Buckets,
+                     LoopInfo &LI, const TargetData *TD,
+                     const InstNumbering &Numbering,
+                     const std::map<Instruction *, unsigned> &LAMPIds,
+                     raw_ostream &OS) {
+        SmallVector<LoadInst *, 32> Loads;
+        SmallVector<StoreInst *, 32> Stores;
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            for (BasicBlock::iterator I = BB->begin(), IE = BB->end();
+                 I != IE; ++I) {
+                if (LoadInst *Load = dyn_cast<LoadInst>(I))
+                    Loads.push_back(Load);
+                else if (StoreInst *Store = dyn_cast<StoreInst>(I))
+                    Stores.push_back(Store);
+            }
+        Ops_ += Loads.size() + Stores.size();
+
+        // A pair only needs to be asked about while one side is unmarked.
+        SmallPtrSet<Instruction *, 32> Kept;
+        for (unsigned s = 0, se = Stores.size(); s != se; ++s) {
+            Value *Ptr;
+            uint64_t Size;
+            if (!getWriteAccess(Stores[s], TD, Ptr, Size))
+                continue;
+            unsigned Bucket = Buckets.getBucket(Ptr);
+            for (unsigned l = 0, le = Loads.size(); l != le; ++l) {
+                if (Kept.count(Stores[s]) && Kept.count(Loads[l]))
+                    continue;
+                if (!MemoryBuckets::compatible(
+                        Buckets.getReadBucket(Loads[l]), Bucket) ||
+                    !Oracle.mayRead(Loads[l], Ptr, Size))
+                    continue;
+                Kept.insert(Stores[s]);
+                Kept.insert(Loads[l]);
+            }
+        }
+        if (Kept.empty())
+            return;
+
+        // Loops around the kept operations, outermost included; written in
+        // layout order like the operations.
+        SmallPtrSet<BasicBlock *, 16> Headers;
+        for (SmallPtrSet<Instruction *, 32>::iterator I = Kept.begin(),
+             E = Kept.end(); I != E; ++I)
+            for (Loop *L = LI.getLoopFor((*I)->getParent()); L;
+                 L = L->getParentLoop())
+                if (!Headers.insert(L->getHeader()))
+                    break;
+
+        for (unsigned i = 0, e = Numbering.getNumInsts(); i != e; ++i) {
+            Instruction *I = Numbering.getInst(i);
+            if (Headers.count(I->getParent()) &&
+                I == &I->getParent()->front()) {
+                OS << F.getName() << " loop " << I->getParent()->getName()
+                   << "\n";
+                ++Loops_;
+            }
+            std::map<Instruction *, unsigned>::const_iterator Id =
+                LAMPIds.find(I);
+            if (Kept.count(I) && Id != LAMPIds.end()) {
+                OS << F.getName() << (isa<LoadInst>(I) ? " load " : " store ")
+                   << Id->second << " " << Numbering.getLocator(*I) << "\n";
+                ++Kept_;
+            }
+        }
+    }
+
+    void print(raw_ostream &OS) const {
+        OS << "LAMP filter: " << Kept_ << " of " << Ops_
+           << " loads and stores, " << Loops_ << " loops\n";
+    }
+
+ private:
+    unsigned Ops_, Kept_, Loops_;
+};
+
+} // End llvm namespace
+
+#endif
@@ -2,161 +2,189 @@
 // Name        : hittingSet.cpp
 // Author      : Haokun Luo
 // Version     :
-// Description : Find the minimum hitting set
+// Description : Find a small hitting set (library, see HittingSet.h)
+//============================================================================
+//
+// The sets arrive in CSR form and are transposed, in two counting passes,
+// into a CSR list of the sets through each node.  Nodes sit in an indexed
+// binary max-heap keyed on how many unhit sets they are on; taking the top
+// node hits its sets, and every other node on a newly hit set drops by one
+// with a decrease-key.  Apart from the input and the picks, the memory used
+// is five words per node, one word per (set, node) incidence and one byte
+// per set, all from the caller's arena.
+//
 //============================================================================
 
-#include <iostream>
-#include <set>
-#include <map>
-using namespace std;
-
-void printSet(set<unsigned int> result) {
-	cout << "Set is { ";
-	int count = 0;
-	for (set<unsigned int>::iterator BB = result.begin(), EE = result.end(); BB != EE; BB++) {
-		count++;
-		if (count == (int)result.size()) {
-			cout << *BB;
-		} else {
-			cout << *BB << ", ";
-		}
-	}
-	cout << "}\n";
-}
+#include "HittingSet.h"
+#include <algorithm>
+#include <vector>
 
-void printMap(map<unsigned int, int> Map) {
-	for (map<unsigned int, int>::iterator B = Map.begin(), E = Map.end(); B != E; B++) {
-		cout << B->first << " -> " << B->second << endl;
-	}
-}
+using namespace llvm;
 
-void printMap(map<int, unsigned int> Map) {
-	for (map<int,unsigned int>::iterator B = Map.begin(), E = Map.end(); B != E; B++) {
-		cout << B->first << " -> " << B->second << endl;
-	}
-}
+namespace {
+// The arrays findHittingSet() works in.
+struct HittingSetState {
+    const unsigned *Count;  // unhit sets through each node
+    unsigned *Heap;         // max-heap of nodes
+    unsigned *Pos;          // heap index of each node, NotInHeap once taken
+    unsigned HeapSize;
+
+    enum { NotInHeap = ~0U };
+
+    // Does A go above B?  More unhit sets, then the smaller id.
+    bool before(unsigned A, unsigned B) const {
+        if (Count[A] != Count[B])
+            return Count[A] > Count[B];
+        return A < B;
+    }
+
+    void place(unsigned Node, unsigned I) {
+        Heap[I] = Node;
+        Pos[Node] = I;
+    }
 
-void print2Darray(int* array, int len, map<int, unsigned int>indexToid) {
-	cout << "  ";
-	for (map<int, unsigned int>::iterator B = indexToid.begin(), E = indexToid.end(); B != E; B++) {
-		cout << B->second << " ";
-	}
-	cout << endl;
-	for (int i = 0; i < len; i++) {
-		cout << indexToid[i] << " ";
-		for (int j = 0; j < len; j++) {
-			cout << array[i*len+j] << " ";
-		}
-		cout << endl;
-	}
+    void siftDown(unsigned I) {
+        unsigned Node = Heap[I];
+        for (;;) {
+            unsigned Child = 2 * I + 1;
+            if (Child >= HeapSize)
+                break;
+            if (Child + 1 < HeapSize && before(Heap[Child + 1], Heap[Child]))
+                ++Child;
+            if (!before(Heap[Child], Node))
+                break;
+            place(Heap[Child], I);
+            I = Child;
+        }
+        place(Node, I);
+    }
+
+    unsigned pop() {
+        unsigned Top = Heap[0];
+        Pos[Top] = NotInHeap;
+        if (--HeapSize) {
+            place(Heap[HeapSize], 0);
+            siftDown(0);
+        }
+        return Top;
+    }
+};
 }
 
-unsigned int largestCountId(map<unsigned int, int> count) {
-	int max = 0;
-	unsigned int max_id = 0;
-	for (map<unsigned int, int>::iterator B = count.begin(), E = count.end(); B != E; B++) {
-		if (B->second > max) {
-			max = B->second;
-			max_id = B->first;
-		}
-	}
-	return max_id;
+size_t llvm::getHittingSetArenaSize(const SetCollection &Sets) {
+    size_t Nodes = Sets.NumNodes, Incidences = Sets.Start[Sets.NumSets];
+    return 4 * HittingSetArena::getSize<unsigned>(Nodes) +
+           HittingSetArena::getSize<unsigned>(Nodes + 1) +
+           HittingSetArena::getSize<unsigned>(Incidences) +
+           HittingSetArena::getSize<char>(Sets.NumSets);
 }
 
-/*******************************************************************/
-/****************** Interface for CS 583 project *******************/
-/*******************************************************************/
-set<unsigned int> findHittingSet(set< set<unsigned int> > domCollection) {
-	// find the maximum covering set
-	set<unsigned int> commonNode;
-	map<unsigned int, int> countNode;
-	map<unsigned int, int> idToindex;
-	map<int, unsigned int> indexToid;
-	int totalCount = 0;
-	for (set< set<unsigned int> >::iterator B = domCollection.begin(), E = domCollection.end(); B != E; B++) {
-		for (set<unsigned int>::iterator BB = B->begin(), EE = B->end(); BB != EE; BB++) {
-			commonNode.insert(*BB);
-		}
-	}
-	cout << "Total Count is " << totalCount << endl;
-	// create a id to index map
-	int mapDim = commonNode.size();
-	int index = 0;
-	for (set<unsigned int>::iterator BB = commonNode.begin(), EE = commonNode.end(); BB != EE; BB++, index++) {
-		idToindex[*BB] = index;
-		indexToid[index] = *BB;
-	}
-	int *edgeMap = new int[mapDim*mapDim];
-	printSet(commonNode);
-	cout << "Id to index map:" << endl;
-	printMap(idToindex);
-	cout << "Index to id map:" << endl;
-	printMap(indexToid);
-	// create a dynamically allocated array
-	for (set< set<unsigned int> >::iterator B = domCollection.begin(), E = domCollection.end(); B != E; B++) {
-		for (set<unsigned int>::iterator BB_first = B->begin(), EE_first = B->end(); BB_first != EE_first; BB_first++) {
-			for (set<unsigned int>::iterator BB_second = B->begin(), EE_second = B->end(); BB_second != EE_second; BB_second++) {
-				if (*BB_first != *BB_second) {
-					if (edgeMap[idToindex[*BB_first]*mapDim+idToindex[*BB_second]] == 0) {
-						edgeMap[idToindex[*BB_first]*mapDim+idToindex[*BB_second]] = 1;
-						// only count upper triangular
-						if (idToindex[*BB_first] > idToindex[*BB_second]) {
-							countNode[*BB_first] += 1;
-							countNode[*BB_second] += 1;
-							totalCount++;
-						}
-					}
-				}
-			}
-		}
-	}
-	cout << "Count map:" << endl;
-	printMap(countNode);
-	print2Darray(edgeMap, mapDim, indexToid);
-	// construct hitting set
-	set<unsigned int> hittingSet;
-	unsigned int curID;
-	int curRowIndex;
-	int edgeCount;
-	while(totalCount > 0) {
-		curID = largestCountId(countNode);
-		curRowIndex = idToindex[curID];
-		edgeCount = 0;
-		// count the number of columns
-		for (int i = 0; i < mapDim; i++) {
-			if (edgeMap[curRowIndex*mapDim + i] == 1) {
-				// reset the other corresponding element
-				edgeMap[i*mapDim + curRowIndex] = 0;
-				edgeCount++;
-			}
-		}
-		hittingSet.insert(curID);
-		countNode.erase(curID);
-		totalCount -= edgeCount;
-	}
-	delete [] edgeMap;
-	cout << "Hitting set is " << endl ;
-	return hittingSet;
+unsigned llvm::findHittingSet(const SetCollection &Sets,
+                              HittingSetArena &Arena, unsigned *Picks) {
+    unsigned N = Sets.NumNodes, S = Sets.NumSets;
+    if (N == 0 || S == 0)
+        return 0;
+    const unsigned *Start = Sets.Start, *Nodes = Sets.Nodes;
+    unsigned *Count = Arena.allocate<unsigned>(N);
+    unsigned *Heap = Arena.allocate<unsigned>(N);
+    unsigned *Pos = Arena.allocate<unsigned>(N);
+    unsigned *Last = Arena.allocate<unsigned>(N);
+    unsigned *NodeStart = Arena.allocate<unsigned>(N + 1);
+    unsigned *NodeSets = Arena.allocate<unsigned>(Start[S]);
+    char *Hit = Arena.allocate<char>(S);
+    if (!Count || !Heap || !Pos || !Last || !NodeStart || !NodeSets || !Hit)
+        return ~0U;
+
+    // Transpose, counting a node once per set however often it repeats.
+    std::fill(Count, Count + N, 0);
+    std::fill(Last, Last + N, ~0U);
+    for (unsigned s = 0; s != S; ++s)
+        for (unsigned i = Start[s], ie = Start[s + 1]; i != ie; ++i)
+            if (Last[Nodes[i]] != s) {
+                Last[Nodes[i]] = s;
+                ++Count[Nodes[i]];
+            }
+    NodeStart[0] = 0;
+    for (unsigned n = 0; n != N; ++n) {
+        NodeStart[n + 1] = NodeStart[n] + Count[n];
+        Pos[n] = NodeStart[n];
+    }
+    std::fill(Last, Last + N, ~0U);
+    for (unsigned s = 0; s != S; ++s)
+        for (unsigned i = Start[s], ie = Start[s + 1]; i != ie; ++i)
+            if (Last[Nodes[i]] != s) {
+                Last[Nodes[i]] = s;
+                NodeSets[Pos[Nodes[i]]++] = s;
+            }
+
+    HittingSetState State;
+    State.Count = Count;
+    State.Heap = Heap;
+    State.Pos = Pos;
+    State.HeapSize = 0;
+    for (unsigned n = 0; n != N; ++n) {
+        Pos[n] = HittingSetState::NotInHeap;
+        if (Count[n])
+            State.place(n, State.HeapSize++);
+    }
+    for (unsigned i = State.HeapSize / 2; i-- != 0; )
+        State.siftDown(i);
+
+    std::fill(Hit, Hit + S, 0);
+    std::fill(Last, Last + N, ~0U);
+    unsigned NumPicks = 0;
+    while (State.HeapSize && Count[Heap[0]]) {
+        unsigned Node = State.pop();
+        Picks[NumPicks++] = Node;
+        for (unsigned j = NodeStart[Node], je = NodeStart[Node + 1]; j != je;
+             ++j) {
+            unsigned s = NodeSets[j];
+            if (Hit[s])
+                continue;
+            Hit[s] = 1;
+            for (unsigned i = Start[s], ie = Start[s + 1]; i != ie; ++i) {
+                unsigned Other = Nodes[i];
+                if (Last[Other] == s)
+                    continue;
+                Last[Other] = s;
+                if (Pos[Other] == HittingSetState::NotInHeap)
+                    continue;
+                --Count[Other];
+                State.siftDown(Pos[Other]);
+            }
+        }
+    }
+    return NumPicks;
 }
 
-int main() {
-	set<unsigned int> first;	// {5}
-	set<unsigned int> second;	// {3,5,7}
-	set<unsigned int> third;	// {5,7,9}
-	set< set<unsigned int> > outer;
-	for (int i = 5; i <= 5; i += 2) {
-		first.insert(i);
-	}
-	for (int i = 3; i <= 7; i += 2) {
-		second.insert(i);
-	}
-	for (int i = 5; i <= 9; i += 2) {
-		third.insert(i);
-	}
-	outer.insert(first);
-	outer.insert(second);
-	outer.insert(third);
-
-	printSet(findHittingSet(outer));
-	return 0;
+std::set<unsigned> llvm::findHittingSet(
+    const std::set<std::set<unsigned> > &Collection) {
+    typedef std::set<std::set<unsigned> >::const_iterator SetIt;
+    std::vector<unsigned> Ids;
+    for (SetIt B = Collection.begin(), E = Collection.end(); B != E; ++B)
+        Ids.insert(Ids.end(), B->begin(), B->end());
+    std::sort(Ids.begin(), Ids.end());
+    Ids.erase(std::unique(Ids.begin(), Ids.end()), Ids.end());
+
+    std::vector<unsigned> Start(1, 0), Nodes;
+    for (SetIt B = Collection.begin(), E = Collection.end(); B != E; ++B) {
+        for (std::set<unsigned>::const_iterator I = B->begin(), IE = B->end();
+             I != IE; ++I)
+            Nodes.push_back(std::lower_bound(Ids.begin(), Ids.end(), *I) -
+                            Ids.begin());
+        Start.push_back(Nodes.size());
+    }
+
+    std::set<unsigned> Result;
+    if (Nodes.empty())
+        return Result;
+    SetCollection Sets = { (unsigned)Ids.size(), (unsigned)Collection.size(),
+                           &Start[0], &Nodes[0] };
+    std::vector<char> Mem(getHittingSetArenaSize(Sets));
+    HittingSetArena Arena(&Mem[0], Mem.size());
+    std::vector<unsigned> Picks(Ids.size());
+    unsigned NumPicks = findHittingSet(Sets, Arena, &Picks[0]);
+    for (unsigned i = 0; i != NumPicks; ++i)
+        Result.insert(Ids[Picks[i]]);
+    return Result;
 }
@@ -32,7 +32,18 @@
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "LAMP/LAMPLoadProfile.h"
+#include "AliasOracle.h"
+#include "AntiDepAnalysis.h"
+#include "FunctionSummaries.h"
+#include "MemoryBuckets.h"
+#include "AntiDepDataflow.h"
+#include "AntiDepSearch.h"
+#include "LoopDistance.h"
+#include "MemoryAccess.h"
+#include "InstNumbering.h"
+#include "IdemOptions.h"
 
 using namespace llvm;
 
@@ -49,6 +60,11 @@ namespace {
         LoopInfo      *LI;       // Current LoopInfo
         DominatorTree *DT;       // Dominator Tree for the current Loop.
         PredIteratorCache PredCache_;   // Cache fetch predecessor of a BB
+        AliasOracle Oracle_;            // Memoized load/store alias queries
+        MemoryBuckets Buckets_;         // Loads/stores grouped by underlying object
+        LoopDistance Distance_;         // Affine loop access disambiguation
+        FunctionSummaries *Summaries_;  // What calls read, write and force
+        InstNumbering Numbering_;       // Instruction locators
           
         typedef std::pair<Instruction *, Instruction *> AntiDepPairTy;
         typedef SmallVector<Instruction *, 16> AntiDepPathTy;  
@@ -60,19 +76,25 @@ namespace {
         // Intermediary data structure 2.
         typedef SmallVector<AntiDepPathTy, 16> AntiDepPaths;
         AntiDepPaths AntiDepPaths_;
+
+        // Writers of F by dominator chain position, for the paths
+        DomPathIndex DomPaths_;
+        SmallVector<Instruction *, 8> WritingCalls_;
         
         // Hitting Set
         typedef SmallPtrSet<Instruction *, 16> HittingSet;
         HittingSet HittingSet_;
 
         // pass constructor
-        idenRegion() : FunctionPass(ID) {}
+        idenRegion() : FunctionPass(ID), Summaries_(0) {}
 
         // get the profile information
         void getAnalysisUsage(AnalysisUsage &AU) const {
             AU.addRequired<DominatorTree>();
             AU.addRequired<LoopInfo>();
+            AU.addRequired<ScalarEvolution>();
             AU.addRequired<AliasAnalysis>();
+            AU.addRequired<FunctionSummaries>();
         }
         
         // Find all necessary information about Function
@@ -81,25 +103,15 @@ namespace {
         //===----------------------------------------------------------------------===//
         // Helpers
         //===----------------------------------------------------------------------===//
-        void findAntidependencePairs(StoreInst *Store);
-        bool scanForAliasingLoad(BasicBlock::iterator I,
-                                 BasicBlock::iterator E,
-                                 StoreInst *Store,
-                                 Value *StoreDst,
-                                 unsigned StoreDstSize);
-        void computeAntidependencePaths();
+        void computeAntidependencePairs(Function &F, ArrayRef<Instruction *> Stores);
+        void findAntidependencePairs(AntiDepSearch &Search,
+                                     ArrayRef<Instruction *> Group);
+        void computeAntidependencePaths(Function &F);
         void computeHittingSet();
         
         // print instruction and its BB location
         std::string getLocator(const Instruction &I) {
-            unsigned Offset = 1;
-            const BasicBlock *BB = I.getParent();
-            for (BasicBlock::const_iterator It = I; It != BB->begin(); --It)
-                ++Offset;
-
-            std::stringstream SS;
-            SS << BB->getName().str() << ":" << Offset;
-            return SS.str();
+            return Numbering_.getLocator(I);
         }
 
         // display anti-dependency pair
@@ -108,6 +120,14 @@ namespace {
             << getLocator(*P.second) << " )";
         }
         
+        // display pairs dropped by the loop distance test
+        void printPruned(ArrayRef<AntiDepPairTy> Pruned) {
+            for (ArrayRef<AntiDepPairTy>::iterator I = Pruned.begin(), E = Pruned.end(); I != E; I++) {
+                errs() << "Independent in loop ( " << getLocator(*I->first) << ", "
+                       << getLocator(*I->second) << " )\n";
+            }
+        }
+
         // display anti-dependency path
         void printPath(const AntiDepPathTy &P) {
             errs() << "[ ";
@@ -142,166 +162,136 @@ bool idenRegion::runOnFunction(Function &F) {
     LI = &getAnalysis<LoopInfo>();
     AA = &getAnalysis<AliasAnalysis>();
     DT = &getAnalysis<DominatorTree>();
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Find Anti-dependency region--------\n";
-    errs() << "---------------------------------------------\n";
+    Summaries_ = &getAnalysis<FunctionSummaries>();
+    // Only the diagnostics name instructions
+    if (isVerbose(SummaryOutput))
+        Numbering_.build(F);
+    Oracle_.reset(AA, Summaries_);
+    Buckets_.build(F, AA->getTargetData());
+    Distance_.reset(LoopDistancePruning ? &getAnalysis<ScalarEvolution>() : 0,
+                    LI, AA->getTargetData());
+    AntiDepPairs_.clear();
+    AntiDepPaths_.clear();
+    WritingCalls_.clear();
+    HittingSet_.clear();
+    Summaries_->forceCuts(F, HittingSet_);
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Find Anti-dependency region--------\n";
+        errs() << "---------------------------------------------\n";
+    }
 
-    errs() << "----------Compute Memory Antidependency Pairs---------\n";
+    if (isVerbose(TraceOutput))
+        errs() << "----------Compute Memory Antidependency Pairs---------\n";
+    SmallVector<Instruction *, 32> Stores;
     for (Function::iterator BB = F.begin(); BB != F.end(); ++BB) {
-        errs() << "##### BB #####" << "\n";
+        if (isVerbose(TraceOutput))
+            errs() << "##### BB #####" << "\n";
         for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ++I) {
-            if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
-                findAntidependencePairs(Store);
+            // Stores, memory intrinsics and writing calls; volatile and
+            // atomic stores are isolated by forced cuts
+            if (isMemoryWriter(I)) {
+                Stores.push_back(I);
+            } else if (Oracle_.isWritingCall(I)) {
+                Stores.push_back(I);
+                WritingCalls_.push_back(I);
             }
         }
     }
-    
+    computeAntidependencePairs(F, Stores);
+
+    if (isVerbose(SummaryOutput)) {
+        Oracle_.print(errs());
+        Buckets_.print(errs());
+        Distance_.print(errs());
+    }
+    if (isVerbose(TraceOutput))
+        printPruned(Distance_.getPruned());
+
     if (AntiDepPairs_.empty())
         return false;
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Find anti-dependency Path----------\n";
-    errs() << "---------------------------------------------\n";
-    computeAntidependencePaths();
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Find anti-dependency Path----------\n";
+        errs() << "---------------------------------------------\n";
+    }
+    computeAntidependencePaths(F);
     
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Compute the Hitting Set------------\n";
-    errs() << "---------------------------------------------\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Compute the Hitting Set------------\n";
+        errs() << "---------------------------------------------\n";
+    }
     computeHittingSet();
 
     return false;
 }
 
-void idenRegion::findAntidependencePairs(StoreInst *Store) {
-    // errs() << "** Analyzing Store: " << *Store << "\n";
-    // errs() << "** At location:     " << getLocator(*Store) << "\n";
-    Value *StoreDst = Store->getOperand(1); // dst
-    // Value *First = Store->getOperand(0); // src
-    // errs() << "Store src type is " << *(First->getType()) << "\n";
-    unsigned StoreDstSize = AA->getTypeStoreSize(Store->getOperand(0)->getType());
-
-    // Perform a reverse depth-first search to find aliasing loads.
-    typedef std::pair<BasicBlock *, BasicBlock::iterator> WorkItem;
-    SmallVector<WorkItem, 8> Worklist;
-    SmallPtrSet<BasicBlock *, 32> Visited;
-
-    BasicBlock *StoreBB = Store->getParent();
-    Worklist.push_back(WorkItem(StoreBB, Store));
+void idenRegion::computeAntidependencePairs(Function &F,
+                                            ArrayRef<Instruction *> Stores) {
+    // One backward dataflow over the whole function
+    if (PairEngine == DataflowPairs) {
+        AntiDepDataflow(Oracle_, Buckets_, AA, &Distance_).run(F, Stores, AntiDepPairs_);
+        return;
+    }
 
-    do {
-        BasicBlock *BB;
-        BasicBlock::iterator I, E;
-        tie(BB, I) = Worklist.pop_back_val();
+    // One reverse DFS per group of stores to the same pointer and size
+    AntiDepSearch Search(Oracle_, Buckets_, AA, PredCache_, &Distance_);
+    std::vector<AntiDepSearch::GroupTy> Groups;
+    Search.groupStores(Stores, Groups);
+    for (unsigned i = 0, e = Groups.size(); i != e; ++i)
+        findAntidependencePairs(Search, Groups[i]);
+    if (isVerbose(SummaryOutput))
+        Search.print(errs());
 
-        // If we are revisiting StoreBB, we scan to Store to complete the cycle.
-        // Otherwise we end at BB->begin().
-        E = (BB == StoreBB && I == BB->end()) ? Store : BB->begin();
-        
-        // Scan for an aliasing load.  Terminate this path if we see one or a cut is
-        // already forced.
-        if (scanForAliasingLoad(I, E, Store, StoreDst, StoreDstSize))
-            continue;
-            
-        // If the path didn't terminate, continue on to predecessors.
-        // errs() << "###### Predecessor Info #######" << "\n";
-        for (BasicBlock **P = PredCache_.GetPreds(StoreBB); *P; ++P) {
-            //errs() << "## Name is " << (*P)->getName() << "\n";
-            if (Visited.insert(*P))
-                Worklist.push_back(WorkItem((*P), (*P)->end()));
-        }
-    } while (!Worklist.empty());
+    // Keep the DFS result, but report where the dataflow engine disagrees
+    if (PairEngine == CrossCheckPairs) {
+        AntiDepPairs Check;
+        AntiDepDataflow(Oracle_, Buckets_, AA, &Distance_).run(F, Stores, Check);
+        checkAntiDepPairs(AntiDepPairs_, Check, errs());
+    }
 }
 
-bool idenRegion::scanForAliasingLoad (BasicBlock::iterator I,
-                                      BasicBlock::iterator E,
-                                      StoreInst *Store,
-                                      Value *StoreDst,
-                                      unsigned StoreDstSize) {
-    // I is the end of the instruction, E is the begining of the instruction
-    while (I != E) {
-        --I;
-        if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
-            // Load all the may alias case
-            if (AA->getModRefInfo(Load, StoreDst, StoreDstSize) & AliasAnalysis::Ref) {
-                errs() << "!!!!Detect AntiDep Pair!!!!\n";
-                AntiDepPairTy Pair = AntiDepPairTy(I, Store);
-                errs() << "~~~ First:  " << *(Pair.first) << "\n";
-                errs() << "~~~ At location " << getLocator(*(Pair.first)) << "\n";
-                errs() << "~~~ Second: " << *(Pair.second) << "\n";
-                errs() << "~~~ At location " << getLocator(*(Pair.second)) << "\n";
-                AntiDepPairs_.push_back(Pair);
-                return true;
-            }
-        }
+void idenRegion::findAntidependencePairs(AntiDepSearch &Search,
+                                         ArrayRef<Instruction *> Group) {
+    // Perform one reverse depth-first search to find the aliasing loads of
+    // every store in the group.
+    unsigned First = AntiDepPairs_.size();
+    Search.run(Group, AntiDepPairs_);
+    if (!isVerbose(TraceOutput))
+        return;
+    for (unsigned i = First, e = AntiDepPairs_.size(); i != e; ++i) {
+        const AntiDepPairTy &Pair = AntiDepPairs_[i];
+        errs() << "!!!!Detect AntiDep Pair!!!!\n";
+        errs() << "~~~ First:  " << *(Pair.first) << "\n";
+        errs() << "~~~ At location " << getLocator(*(Pair.first)) << "\n";
+        errs() << "~~~ Second: " << *(Pair.second) << "\n";
+        errs() << "~~~ At location " << getLocator(*(Pair.second)) << "\n";
     }
-    return false;
 }
 
-void idenRegion::computeAntidependencePaths() {
-    // Iterate through every pair of antidependency
-    // Record all the store along the path
-    for (AntiDepPairs::iterator I = AntiDepPairs_.begin(), E = AntiDepPairs_.end(); I != E; I++) {
-        BasicBlock::iterator Load, Store;
-        tie(Load, Store) = *I;
-
-        // create a new path
-        AntiDepPaths_.resize(AntiDepPaths_.size()+1);
-        AntiDepPathTy &newPath = AntiDepPaths_.back();
-
-        // Always record current store
-        newPath.push_back(Store);
+void idenRegion::computeAntidependencePaths(Function &F) {
+    // Every pair is an interval of the dominator chain of its store; the
+    // duplicate and subsumed ones are dropped before any path is written
+    DomPaths_.build(F, *DT, WritingCalls_);
+    PathReductionStats Reduction;
+    computeAntiDepPaths(DomPaths_, AntiDepPairs_, AntiDepPaths_,
+                        ReducePaths ? &Reduction : 0);
+    if (ReducePaths && isVerbose(SummaryOutput))
+        errs() << "Path reduction: " << Reduction.Paths << " paths, "
+               << Reduction.Duplicates << " duplicate, "
+               << Reduction.Subsumed << " subsumed, "
+               << Reduction.getKept() << " kept\n";
 
-        // Load and store in the same basic block
-        BasicBlock::iterator curInst = Store;
-        BasicBlock *LoadBB = Load->getParent(), *StoreBB = Store->getParent();
-        if (LoadBB == StoreBB && DT->dominates(Load, Store)) {
-            while(--curInst != Load) {
-                if (isa<StoreInst>(curInst))
-                    newPath.push_back(curInst);
-            }
-            errs() << "@@@ Local BB: \n@@@ ";
-            printPath(newPath);
-            errs() << "\n";
-            continue;
-        }
-
-        // Load and store in different basic block
-        BasicBlock *curBB = StoreBB;
-        DomTreeNode *curDTNode = DT->getNode(StoreBB), *LoadDTNode = DT->getNode(LoadBB);
-        // loop until load is not 
-        while (DT->dominates(LoadDTNode, curDTNode)) {
-            errs() << "^^^^^ Current BB is " << curBB->getName() << "\n";
-            BasicBlock::iterator E;
-            // check if Load and current node in the same BB
-            if (curBB == LoadBB) {
-                E = Load;
-            } else {
-                E = curBB->begin();
-            }
-            // scan current BB
-            while(curInst != E) {
-                if (isa<StoreInst>(--curInst)) {
-                    newPath.push_back(curInst);
-                }
-            }
-            // find current Node's iDOM
-            curDTNode = curDTNode->getIDom();
-            if (curDTNode == NULL)
-                break;domCollection
-            curBB = curDTNode->getBlock();
-            curInst = curBB->end();
-        }
-        errs() << "@@@ Inter BB: \n@@@ ";
-        printPath(newPath);
+    if (isVerbose(TraceOutput)) {
+        errs() << "Path cap is " << AntiDepPaths_.capacity() << "\n";
+        errs() << "Path size is " << AntiDepPaths_.size() << "\n";
+        errs() << "#########################################################\n";
+        errs() << "#################### Paths Summary ######################\n";
+        errs() << "#########################################################\n";
+        printCollection(AntiDepPaths_);
         errs() << "\n";
     }
-    
-    errs() << "Path cap is " << AntiDepPaths_.capacity() << "\n";
-    errs() << "Path size is " << AntiDepPaths_.size() << "\n";
-    errs() << "#########################################################\n";
-    errs() << "#################### Paths Summary ######################\n";
-    errs() << "#########################################################\n";
-    printCollection(AntiDepPaths_);
-    errs() << "\n";
 }
 
 void idenRegion::computeHittingSet() {
@@ -12,6 +12,7 @@
 //===----------------------------------------------------------------------===//
 
 #define DEBUG_TYPE "idenRegion"
+#include <algorithm>
 #include <sstream>
 #include <string>
 #include <iomanip>
@@ -21,10 +22,12 @@
 #include "llvm/InstrTypes.h"
 #include "llvm/Pass.h"
 #include "llvm/Module.h"
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/SmallPtrSet.h"
 #include "llvm/BasicBlock.h"
 #include "llvm/Instructions.h"
+#include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/PredIteratorCache.h"
 #include "llvm/Analysis/AliasAnalysis.h"
@@ -32,7 +35,23 @@
 #include "llvm/Analysis/Dominators.h"
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ProfileInfo.h"
+#include "llvm/Analysis/ScalarEvolution.h"
 #include "LAMP/LAMPLoadProfile.h"
+#include "AcyclicReachability.h"
+#include "AliasOracle.h"
+#include "AntiDepAnalysis.h"
+#include "FunctionSummaries.h"
+#include "MemoryBuckets.h"
+#include "PairCounts.h"
+#include "AntiDepDataflow.h"
+#include "AntiDepSearch.h"
+#include "LoopDistance.h"
+#include "MemoryAccess.h"
+#include "PriorityHittingSet.h"
+#include "CutSetCache.h"
+#include "IncrementalHittingSet.h"
+#include "IdemOptions.h"
 
 using namespace llvm;
 
@@ -50,6 +69,19 @@ namespace {
         DominatorTree *DT;       // Dominator Tree for the current Loop.
         LAMPLoadProfile *LLP;    // LAMP profiling
         PredIteratorCache PredCache_;   // Cache fetch predecessor of a BB
+        AliasOracle Oracle_;            // Memoized load/store alias queries
+        MemoryBuckets Buckets_;         // Loads/stores grouped by underlying object
+        LoopDistance Distance_;         // Affine loop access disambiguation
+        FunctionSummaries *Summaries_;  // What calls read, write and force
+        AcyclicReachability *Reach_;    // Does a profiled store follow its load
+        InstNumbering Numbering_;       // Instruction locators and cache names
+        CutSetCache Cache_;             // Results of previously analyzed functions
+        BlockCountMap BlockCounts_;     // Profiled block counts (-idem-profile-weights)
+        MergedBlockCounts MergedCounts_; // ... from -idem-profile-file
+        IdemProfile DepProfile_;        // Merged dependence counts, same file
+        uint64_t BaseKey_;              // Cache key without the profile (-idem-incremental-cuts)
+        CutSetCache::Entry Base_;       // Last results for this body, if HaveBase_
+        bool HaveBase_;
           
         typedef std::pair<Instruction *, Instruction *> AntiDepPairTy;
         typedef SmallVector<Instruction *, 16> AntiDepPathTy;  
@@ -61,6 +93,10 @@ namespace {
         // Intermediary data structure 2.
         typedef SmallVector<AntiDepPathTy, 16> AntiDepPaths;
         AntiDepPaths AntiDepPaths_;
+
+        // Writers of F by dominator chain position, for the paths
+        DomPathIndex DomPaths_;
+        SmallVector<Instruction *, 8> WritingCalls_;
         
         // Hitting set of instructions
         typedef SmallPtrSet<Instruction *, 16> SmallPtrSetTy;
@@ -69,18 +105,70 @@ namespace {
         // NEW
         // Dynamic Load/Store Path
         AntiDepPairs DynamicPairs_;
+        // The loads of DynamicPairs_ by store
+        typedef DenseMap<StoreInst *, SmallVector<LoadInst *, 2> > DynamicLoadMap;
+        DynamicLoadMap DynamicLoads_;
+        // Times each trusted pair was seen, and with -idem-pair-count-weights
+        // the weight of each path
+        DenseMap<AntiDepPairTy, uint64_t> PairCounts_;
+        std::vector<double> PathWeights_;
+        // The profiled pairs of the module by function with their counts,
+        // and the count a pair needs to be trusted (-idem-pair-percentile);
+        // both set on the first function
+        typedef std::pair<AntiDepPairTy, uint64_t> ProfiledPairTy;
+        typedef DenseMap<const Function *, std::vector<ProfiledPairTy> >
+            ProfiledPairMap;
+        ProfiledPairMap ProfiledPairs_;
+        uint64_t MinTrustedCount_;
+        bool HaveProfiledPairs_;
+        DynamicRegionReport Regions_, TotalRegions_;
 
         // pass constructor
-        idenRegion() : FunctionPass(ID) {}
+        idenRegion() : FunctionPass(ID), Summaries_(0), Reach_(0),
+                       BaseKey_(0), HaveBase_(false), MinTrustedCount_(0),
+                       HaveProfiledPairs_(false) {}
 
         // get the profile information
         void getAnalysisUsage(AnalysisUsage &AU) const {
             AU.addRequired<DominatorTree>();
             AU.addRequired<LoopInfo>();
+            AU.addRequired<ScalarEvolution>();
             AU.addRequired<AliasAnalysis>();
+            AU.addRequired<FunctionSummaries>();
             AU.addRequired<LAMPLoadProfile>();
+            AU.addRequired<AcyclicReachability>();
+            if (ProfileWeightedCuts && MergedProfileFile.empty())
+                AU.addRequired<ProfileInfo>();
+        }
+
+        virtual bool doInitialization(Module &M) {
+            Cache_.init(CutCacheDir, (uint64_t)CutCacheMaxMB << 20);
+            std::string Error;
+            if (ProfileWeightedCuts && !MergedProfileFile.empty() &&
+                !MergedCounts_.load(MergedProfileFile.c_str(), M, Error))
+                report_fatal_error(Error);
+            if (!MergedProfileFile.empty() &&
+                !DepProfile_.map(MergedProfileFile.c_str(), Error))
+                report_fatal_error(Error);
+            ProfiledPairs_.clear();
+            HaveProfiledPairs_ = false;
+            TotalRegions_ = DynamicRegionReport();
+            return false;
+        }
+
+        virtual bool doFinalization(Module &M) {
+            if (isVerbose(SummaryOutput) && TotalRegions_.Pairs) {
+                errs() << "Module: ";
+                TotalRegions_.print(errs());
+            }
+            if (Cache_.enabled()) {
+                if (isVerbose(SummaryOutput))
+                    Cache_.print(errs());
+                Cache_.evict();
+            }
+            return false;
         }
-       
+
         // Find all necessary information about Function
         virtual bool runOnFunction(Function &F);          
         
@@ -96,32 +184,31 @@ namespace {
         ////////////////
         // New End
         ////////////////
-        void findAntidependencePairs(StoreInst *Store);
-        bool scanForAliasingLoad(BasicBlock::iterator I,
-                                 BasicBlock::iterator E,
-                                 StoreInst *Store,
-                                 Value *StoreDst,
-                                 unsigned StoreDstSize);
-        void computeAntidependencePaths();
+        void computeAntidependencePairs(Function &F, ArrayRef<Instruction *> Stores);
+        void findAntidependencePairs(AntiDepSearch &Search,
+                                     ArrayRef<Instruction *> Group);
+        void computeAntidependencePaths(Function &F);
         void computeHittingSet();
+        bool useIncrementalCuts() const;
+        void repairHittingSet();
         // return a set of BB that need cut
         std::set<BasicBlock *> computeHittingSetinBB();
+        std::string getCacheOptions(Function &F, bool WithProfile = true);
+        void bucketProfiledPairs();
+        void addProfiledPair(Instruction *Load, Instruction *Store,
+                             uint64_t Count, std::vector<uint64_t> &Counts);
+        bool isTrustedCount(uint64_t Count) const;
+        void accountRegions(Function &F);
+        void printResult();
+        void cacheResult(uint64_t Key);
 
-        Instruction* findLargestCount(std::map<Instruction *, int> Map);
         
         //===----------------------------------------------------------------------===//
         // Printers
         //===----------------------------------------------------------------------===//
         // print instruction and its BB location
         std::string getLocator(const Instruction &I) {
-            unsigned Offset = 1;
-            const BasicBlock *BB = I.getParent();
-            for (BasicBlock::const_iterator It = I; It != BB->begin(); --It)
-                ++Offset;
-
-            std::stringstream SS;
-            SS << BB->getName().str() << ":" << Offset;
-            return SS.str();
+            return Numbering_.getLocator(I);
         }
 
         // display anti-dependency pair
@@ -141,6 +228,14 @@ namespace {
             errs() << " ]";
         }
         
+        // display pairs dropped by the loop distance test
+        void printPruned(ArrayRef<AntiDepPairTy> Pruned) {
+            for (ArrayRef<AntiDepPairTy>::iterator I = Pruned.begin(), E = Pruned.end(); I != E; I++) {
+                errs() << "Independent in loop ( " << getLocator(*I->first) << ", "
+                       << getLocator(*I->second) << " )\n";
+            }
+        }
+
         // display anti-dependency path
         void printPath(const AntiDepPathTy &P) {
             errs() << "[ ";
@@ -243,62 +338,135 @@ bool idenRegion::runOnFunction(Function &F) {
     LI = &getAnalysis<LoopInfo>();
     AA = &getAnalysis<AliasAnalysis>();
     DT = &getAnalysis<DominatorTree>();
+    Summaries_ = &getAnalysis<FunctionSummaries>();
+    Reach_ = &getAnalysis<AcyclicReachability>();
+    BlockCounts_.clear();
+    if (ProfileWeightedCuts && MergedCounts_.loaded())
+        MergedCounts_.getBlockCounts(F, BlockCounts_);
+    else if (ProfileWeightedCuts)
+        getBlockCounts(getAnalysis<ProfileInfo>(), F, BlockCounts_);
     LLP = &getAnalysis<LAMPLoadProfile>();
-    typedef std::map<std::pair<Instruction*, Instruction*>*, unsigned int> dynamicDepMapTy;
-    typedef std::map<BasicBlock*, std::set<std::pair<Instruction*, Instruction*>* > > LoopToDepTy;
-    typedef std::set<std::pair<Instruction*, Instruction*>* > instSetTy;
-    dynamicDepMapTy dynamicDepMap = LLP->DepToTimesMap;
-    LoopToDepTy LoopToDep = LLP->LoopToDepSetMap;
+    AntiDepPairs_.clear();
+    AntiDepPaths_.clear();
+    WritingCalls_.clear();
+    HittingSet_.clear();
+    DynamicPairs_.clear();
+    DynamicLoads_.clear();
+    PairCounts_.clear();
+    PathWeights_.clear();
+    Regions_ = DynamicRegionReport();
+    HaveBase_ = false;
+    Numbering_.build(F);
+    if (!HaveProfiledPairs_)
+        bucketProfiledPairs();
     
     //////////////
     // NEW begin
     //////////////
-    errs() << "*********************************************\n";
-    errs() << "************* LAMP information **************\n";
-    errs() << "*********************************************\n";
-    errs() << "       Inst_1   -->     Innt_2\tCount\n";
-    for (dynamicDepMapTy::iterator I = dynamicDepMap.begin(), E = dynamicDepMap.end(); I != E; I++) {
-        Instruction *firstInst = I->first->first;
-        Instruction *secondInst = I->first->second;
-        errs() << *(firstInst->getType()) << ";" << getLocator(*firstInst) << " --> " \
-               << *(secondInst->getType()) << ";" << getLocator(*secondInst) << "\t" << I->second << "\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "*********************************************\n";
+        errs() << "************* LAMP information **************\n";
+        errs() << "*********************************************\n";
+        errs() << "       Inst_1   -->     Innt_2\tCount\n";
+    }
+    ProfiledPairMap::const_iterator Profiled = ProfiledPairs_.find(&F);
+    unsigned NumProfiled =
+        Profiled == ProfiledPairs_.end() ? 0 : Profiled->second.size();
+    for (unsigned i = 0; i != NumProfiled; ++i) {
+        Instruction *firstInst = Profiled->second[i].first.first;
+        Instruction *secondInst = Profiled->second[i].first.second;
+        uint64_t Count = Profiled->second[i].second;
+        if (isVerbose(TraceOutput)) {
+            errs() << *(firstInst->getType()) << ";" << getLocator(*firstInst) << " --> " \
+                   << *(secondInst->getType()) << ";" << getLocator(*secondInst) << "\t" << Count << "\n";
+        }
         // push load/store into Dynamic pair if load/store is actually anti-dep
         if (isa<LoadInst>(firstInst) && isa<StoreInst>(secondInst)) {
             LoadInst *Load = dyn_cast<LoadInst>(firstInst);
             StoreInst *Store = dyn_cast<StoreInst>(secondInst);
             if (Load && Store){
-                errs() << "Working on the load/store pair ...\n";
+                if (isVerbose(TraceOutput))
+                    errs() << "Working on the load/store pair ...\n";
                 if (isAntiDepPair(Load, Store)) {
-                    AntiDepPairTy dynPair = AntiDepPairTy(Load, Store);
-                    DynamicPairs_.push_back(dynPair);
+                    // pairs seen too rarely are left to the static search
+                    bool Trusted = isTrustedCount(Count);
+                    Regions_.addPair(Count, Trusted);
+                    if (Trusted) {
+                        AntiDepPairTy dynPair = AntiDepPairTy(Load, Store);
+                        DynamicPairs_.push_back(dynPair);
+                        DynamicLoads_[Store].push_back(Load);
+                        PairCounts_[dynPair] += Count;
+                    }
                 }
             }
         }
     }
-    errs() << "#############################\n";
-    errs() << "#### Right dynamic pairs: \n";
-    errs() << "#############################\n";
-    printPairs(DynamicPairs_);
-    errs() << "\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "#############################\n";
+        errs() << "#### Right dynamic pairs: \n";
+        errs() << "#############################\n";
+        printPairs(DynamicPairs_);
+        errs() << "\n";
+    }
     /////////////
     // New end
     /////////////
 
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Find Anti-dependency region--------\n";
-    errs() << "---------------------------------------------\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Find Anti-dependency region--------\n";
+        errs() << "---------------------------------------------\n";
+    }
 
-    errs() << "----------Compute Memory Antidependency Pairs---------\n";
+    // An unchanged function with the same profiled pairs gets the cut set of
+    // its last analysis
+    uint64_t CacheKey = 0;
+    if (Cache_.enabled()) {
+        CacheKey = CutSetCache::getKey(F, getCacheOptions(F));
+        CutSetCache::Entry Cached;
+        if (Cache_.lookup(CacheKey, Numbering_, Cached)) {
+            CutSetCache::restore(Numbering_, Cached, AntiDepPairs_,
+                                 AntiDepPaths_, HittingSet_);
+            if (isVerbose(SummaryOutput))
+                errs() << "----------Cached: " << AntiDepPairs_.size()
+                       << " pairs, " << AntiDepPaths_.size() << " paths---------\n";
+            accountRegions(F);
+            printResult();
+            return false;
+        }
+        // Same body under another profile: start from its cuts
+        if (useIncrementalCuts()) {
+            BaseKey_ = CutSetCache::getKey(F, getCacheOptions(F, false));
+            Base_ = CutSetCache::Entry();
+            HaveBase_ = Cache_.lookup(BaseKey_, Numbering_, Base_);
+        }
+    }
+    Oracle_.reset(AA, Summaries_);
+    Buckets_.build(F, AA->getTargetData());
+    Distance_.reset(LoopDistancePruning ? &getAnalysis<ScalarEvolution>() : 0,
+                    LI, AA->getTargetData());
+    Summaries_->forceCuts(F, HittingSet_);
+
+    if (isVerbose(TraceOutput))
+        errs() << "----------Compute Memory Antidependency Pairs---------\n";
+    SmallVector<Instruction *, 32> Stores;
     for (Function::iterator BB = F.begin(); BB != F.end(); ++BB) {
-        errs() << "##### BB #####" << "\n";
+        if (isVerbose(TraceOutput))
+            errs() << "##### BB #####" << "\n";
         for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ++I) {
-            if (StoreInst *Store = dyn_cast<StoreInst>(I)) {
+            // Stores, memory intrinsics and writing calls; volatile and
+            // atomic stores are isolated by forced cuts
+            if (Oracle_.isWritingCall(I)) {
+                Stores.push_back(I);
+                WritingCalls_.push_back(I);
+            } else if (isMemoryWriter(I)) {
                 //////////////
                 // NEW begin
                 //////////////
                 // check if we already find the load/store pair in the LAMP profile info
-                if (!IsStoreInDynPairs(Store)) {
-                    findAntidependencePairs(Store);
+                StoreInst *Store = dyn_cast<StoreInst>(I);
+                if (!Store || !IsStoreInDynPairs(Store)) {
+                    Stores.push_back(I);
                 }
                 //////////////
                 // New End
@@ -306,291 +474,316 @@ bool idenRegion::runOnFunction(Function &F) {
             }
         }
     }
+    computeAntidependencePairs(F, Stores);
     
-    errs() << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n";
-    errs() << "^^^^^^ Anti-Dep Pair ^^^^^^^\n";
-    errs() << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n";
-    printPairs(AntiDepPairs_);
-    errs() << "\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n";
+        errs() << "^^^^^^ Anti-Dep Pair ^^^^^^^\n";
+        errs() << "^^^^^^^^^^^^^^^^^^^^^^^^^^^^\n";
+        printPairs(AntiDepPairs_);
+        errs() << "\n";
+    }
+
+    if (isVerbose(SummaryOutput)) {
+        Oracle_.print(errs());
+        Buckets_.print(errs());
+        Distance_.print(errs());
+    }
+    if (isVerbose(TraceOutput))
+        printPruned(Distance_.getPruned());
 
-    if (AntiDepPairs_.empty())
+    if (AntiDepPairs_.empty()) {
+        cacheResult(CacheKey);
+        accountRegions(F);
+        printResult();
         return false;
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Find anti-dependency Path----------\n";
-    errs() << "---------------------------------------------\n";
-    computeAntidependencePaths();
+    }
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Find anti-dependency Path----------\n";
+        errs() << "---------------------------------------------\n";
+    }
+    computeAntidependencePaths(F);
     
-    errs() << "---------------------------------------------\n";
-    errs() << "----------Compute the Hitting Set------------\n";
-    errs() << "---------------------------------------------\n";
+    if (isVerbose(TraceOutput)) {
+        errs() << "---------------------------------------------\n";
+        errs() << "----------Compute the Hitting Set------------\n";
+        errs() << "---------------------------------------------\n";
+    }
     computeHittingSet();
-    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
-    errs() << "!!!!! Hitting Set is !!!!!!\n";
-    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
-    printHittingSet(HittingSet_);
-    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
-    errs() << "!!!! Hitting Set BB is !!!!\n";
-    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
-    printSet(computeHittingSetinBB());
+    cacheResult(CacheKey);
+
+    accountRegions(F);
+    printResult();
     return false;
 }
 
 ///////////////////
 // NEW begin
 ///////////////////
-// check dynamic pair satisfy anti-dependency
+// check dynamic pair satisfy anti-dependency: the store follows the load
+// without going around a loop
 bool idenRegion::isAntiDepPair(LoadInst *Load, StoreInst *Store) {
-    // perform a DFS to check if store is after load
-    typedef std::pair<BasicBlock *, BasicBlock::iterator> WorkItem;
-    SmallVector<WorkItem, 8> Worklist;
-    SmallPtrSet<BasicBlock *, 32> Visited;
-
-    BasicBlock *LoadBB = Load->getParent();
-    Worklist.push_back(WorkItem(LoadBB, Load));
-
-    do {
-        BasicBlock *BB;
-        BasicBlock::iterator I, E;
-        tie(BB, I) = Worklist.pop_back_val();
-
-        errs() << "... On BB " << BB->getName() << "\n";
-        
-        // If we revisited LoadBB, we scan to Load to complete cycle
-        // Otherwise we end at BB->end()
-        E = (BB == LoadBB && I == BB->begin()) ? Load : BB->end();
-        // errs() << "... Last instruction on current BB is " << getLocator(*E) << "\n";
-
-        // iterate throught BB to check if Load instruction exist in the BB
-        while (I != E) {
-            // errs() << "...... Inst: " << getLocator(*I) << "\n";
-            if (isa<StoreInst>(I) && dyn_cast<StoreInst>(I) == Store) {
-                return true;
-            }
-            ++I;
-        }
-        
-        // get current BB's succesor
-        TerminatorInst* ti = BB->getTerminator();
-        int numSuccesor = ti->getNumSuccessors();
-        for (int i = 0; i < numSuccesor; i++) {
-            BasicBlock* nextSuc = ti->getSuccessor(i);
-            // don't count backedge
-            if (Visited.insert(nextSuc) && !DT->dominates(nextSuc, BB)) {
-                Worklist.push_back(WorkItem(nextSuc, nextSuc->begin()));
-            }
-        }
-    } while(!Worklist.empty());
-
-    return false;
+    return Reach_->isReachable(Load, Store);
 }
 
 bool idenRegion::IsStoreInDynPairs(StoreInst *Store) {
-    // iterate dynamic analysis
-    for (AntiDepPairs::iterator I = DynamicPairs_.begin(), E = DynamicPairs_.end(); I != E; I++) {
-        if (dyn_cast<StoreInst>(I->second) == Store) {
-            if (LoadInst* Load = dyn_cast<LoadInst>(I->first)) {
-                AntiDepPairTy Pair = AntiDepPairTy(Load, Store);
-                // insert into dependent path
-                AntiDepPairs_.push_back(Pair);
-                return true;
-            }
-        }
-    }
-    return false;
+    DynamicLoadMap::iterator I = DynamicLoads_.find(Store);
+    if (I == DynamicLoads_.end())
+        return false;
+    // insert every profiled load of the store into dependent path
+    for (unsigned i = 0, e = I->second.size(); i != e; ++i)
+        AntiDepPairs_.push_back(AntiDepPairTy(I->second[i], Store));
+    return true;
 }
 ////////////////
 // New End
 ////////////////
 
-void idenRegion::findAntidependencePairs(StoreInst *Store) {
-    // errs() << "** Analyzing Store: " << *Store << "\n";
-    // errs() << "** At location:     " << getLocator(*Store) << "\n";
-    Value *StoreDst = Store->getOperand(1); // dst
-    // Value *First = Store->getOperand(0); // src
-    // errs() << "Store src type is " << *(First->getType()) << "\n";
-    unsigned StoreDstSize = AA->getTypeStoreSize(Store->getOperand(0)->getType());
-
-    // Perform a reverse depth-first search to find aliasing loads.
-    typedef std::pair<BasicBlock *, BasicBlock::iterator> WorkItem;
-    SmallVector<WorkItem, 8> Worklist;
-    SmallPtrSet<BasicBlock *, 32> Visited;
-
-    BasicBlock *StoreBB = Store->getParent();
-    Worklist.push_back(WorkItem(StoreBB, Store));
-
-    do {
-        BasicBlock *BB;
-        BasicBlock::iterator I, E;
-        tie(BB, I) = Worklist.pop_back_val();
-
-        // If we are revisiting StoreBB, we scan to Store to complete the cycle.
-        // Otherwise we end at BB->begin().
-        E = (BB == StoreBB && I == BB->end()) ? Store : BB->begin();
-        
-        // Scan for an aliasing load.  Terminate this path if we see one or a cut is
-        // already forced.
-        if (scanForAliasingLoad(I, E, Store, StoreDst, StoreDstSize))
-            continue;
-            
-        // If the path didn't terminate, continue on to predecessors.
-        // errs() << "###### Predecessor Info #######" << "\n";
-        for (BasicBlock **P = PredCache_.GetPreds(StoreBB); *P; ++P) {
-            //errs() << "## Name is " << (*P)->getName() << "\n";
-            if (Visited.insert(*P))
-                Worklist.push_back(WorkItem((*P), (*P)->end()));
-        }
-    } while (!Worklist.empty());
+void idenRegion::computeAntidependencePairs(Function &F,
+                                            ArrayRef<Instruction *> Stores) {
+    // One backward dataflow over the whole function
+    if (PairEngine == DataflowPairs) {
+        AntiDepDataflow(Oracle_, Buckets_, AA, &Distance_).run(F, Stores, AntiDepPairs_);
+        return;
+    }
+
+    // One reverse DFS per group of stores to the same pointer and size
+    unsigned First = AntiDepPairs_.size();
+    AntiDepSearch Search(Oracle_, Buckets_, AA, PredCache_, &Distance_);
+    std::vector<AntiDepSearch::GroupTy> Groups;
+    Search.groupStores(Stores, Groups);
+    for (unsigned i = 0, e = Groups.size(); i != e; ++i)
+        findAntidependencePairs(Search, Groups[i]);
+    if (isVerbose(SummaryOutput))
+        Search.print(errs());
+
+    // Keep the DFS result, but report where the dataflow engine disagrees
+    if (PairEngine == CrossCheckPairs) {
+        AntiDepPairs Check;
+        AntiDepDataflow(Oracle_, Buckets_, AA, &Distance_).run(F, Stores, Check);
+        checkAntiDepPairs(ArrayRef<AntiDepPairTy>(AntiDepPairs_.begin() + First,
+                                                  AntiDepPairs_.end()),
+                          Check, errs());
+    }
 }
 
-bool idenRegion::scanForAliasingLoad (BasicBlock::iterator I,
-                                      BasicBlock::iterator E,
-                                      StoreInst *Store,
-                                      Value *StoreDst,
-                                      unsigned StoreDstSize) {
-    // I is the end of the instruction, E is the begining of the instruction
-    while (I != E) {
-        --I;
-        if (LoadInst *Load = dyn_cast<LoadInst>(I)) {
-            // Load all the may alias case
-            if (AA->getModRefInfo(Load, StoreDst, StoreDstSize) & AliasAnalysis::Ref) {
-                errs() << "!!!!Detect AntiDep Pair!!!!\n";
-                AntiDepPairTy Pair = AntiDepPairTy(I, Store);
-                errs() << "~~~ First:  " << *(Pair.first) << "\n";
-                errs() << "~~~ At location " << getLocator(*(Pair.first)) << "\n";
-                errs() << "~~~ Second: " << *(Pair.second) << "\n";
-                errs() << "~~~ At location " << getLocator(*(Pair.second)) << "\n";
-                AntiDepPairs_.push_back(Pair);
-                return true;
-            }
-        }
+void idenRegion::findAntidependencePairs(AntiDepSearch &Search,
+                                         ArrayRef<Instruction *> Group) {
+    // Perform one reverse depth-first search to find the aliasing loads of
+    // every store in the group.
+    unsigned First = AntiDepPairs_.size();
+    Search.run(Group, AntiDepPairs_);
+    if (!isVerbose(TraceOutput))
+        return;
+    for (unsigned i = First, e = AntiDepPairs_.size(); i != e; ++i) {
+        const AntiDepPairTy &Pair = AntiDepPairs_[i];
+        errs() << "!!!!Detect AntiDep Pair!!!!\n";
+        errs() << "~~~ First:  " << *(Pair.first) << "\n";
+        errs() << "~~~ At location " << getLocator(*(Pair.first)) << "\n";
+        errs() << "~~~ Second: " << *(Pair.second) << "\n";
+        errs() << "~~~ At location " << getLocator(*(Pair.second)) << "\n";
     }
-    return false;
 }
 
-void idenRegion::computeAntidependencePaths() {
-    // Iterate through every pair of antidependency
-    // Record all the store along the path
-    for (AntiDepPairs::iterator I = AntiDepPairs_.begin(), E = AntiDepPairs_.end(); I != E; I++) {
-        BasicBlock::iterator Load, Store;
-        tie(Load, Store) = *I;
-
-        // create a new path
-        AntiDepPaths_.resize(AntiDepPaths_.size()+1);
-        AntiDepPathTy &newPath = AntiDepPaths_.back();
-
-        // Always record current store
-        newPath.push_back(Store);
-
-        // Load and store in the same basic block
-        BasicBlock::iterator curInst = Store;
-        BasicBlock *LoadBB = Load->getParent(), *StoreBB = Store->getParent();
-        if (LoadBB == StoreBB && DT->dominates(Load, Store)) {
-            while(--curInst != Load) {
-                if (isa<StoreInst>(curInst))
-                    newPath.push_back(curInst);
-            }
-            errs() << "@@@ Local BB: \n@@@ ";
-            printPath(newPath);
+void idenRegion::computeAntidependencePaths(Function &F) {
+    // Every pair is an interval of the dominator chain of its store; the
+    // duplicate and subsumed ones are dropped before any path is written
+    DomPaths_.build(F, *DT, WritingCalls_);
+    PathReductionStats Reduction;
+    std::vector<unsigned> PairOf;
+    computeAntiDepPaths(DomPaths_, AntiDepPairs_, AntiDepPaths_,
+                        ReducePaths ? &Reduction : 0, &PairOf);
+    // A path weighs one more than the times the profile saw its pair
+    if (PairCountWeightedCuts)
+        for (unsigned i = 0, e = PairOf.size(); i != e; ++i)
+            PathWeights_.push_back(
+                1.0 + PairCounts_.lookup(AntiDepPairs_[PairOf[i]]));
+    if (ReducePaths && isVerbose(SummaryOutput))
+        errs() << "Path reduction: " << Reduction.Paths << " paths, "
+               << Reduction.Duplicates << " duplicate, "
+               << Reduction.Subsumed << " subsumed, "
+               << Reduction.getKept() << " kept\n";
+
+    if (isVerbose(TraceOutput)) {
+        errs() << "Path cap is " << AntiDepPaths_.capacity() << "\n";
+        errs() << "Path size is " << AntiDepPaths_.size() << "\n";
+        errs() << "#########################################################\n";
+        errs() << "#################### Paths Summary ######################\n";
+        errs() << "#########################################################\n";
+        printCollection(AntiDepPaths_);
+        errs() << "\n";
+    }
+}
+
+void idenRegion::computeHittingSet() {
+    if (isVerbose(TraceOutput)) {
+        int index = 0;
+        for (AntiDepPaths::iterator I = AntiDepPaths_.begin(), E = AntiDepPaths_.end(); I != E; I++, index++) {
+            errs() << "   " << index << ": ";
+            printPath(*I);
             errs() << "\n";
-            continue;
         }
+    }
+    if (ExactHittingSetMode) {
+        HittingSetBound Bound;
+        computeExactHittingSet(AntiDepPaths_, HittingSet_, Bound);
+        if (isVerbose(SummaryOutput))
+            errs() << "Exact hitting set: " << Bound.Cuts << " cuts (greedy "
+                   << Bound.Greedy << "), lower bound " << Bound.LowerBound
+                   << (Bound.Optimal ? ", optimal\n" : ", budget exhausted\n");
+    } else if (ProfileWeightedCuts) {
+        // Cuts cost their block count; paths weigh their pair count with
+        // -idem-pair-count-weights and 1 without
+        CutCostReport Report;
+        computeCostWeightedHittingSet(AntiDepPaths_, PathWeights_,
+                                      BlockCountCost(BlockCounts_),
+                                      HittingSet_, Report);
+        if (isVerbose(SummaryOutput))
+            errs() << (PairCountWeightedCuts ? "Profile- and pair-count-"
+                                             : "Profile-")
+                   << "weighted cuts: " << Report.Weighted
+                   << " estimated dynamic cut executions (unweighted "
+                   << Report.Unweighted << ")\n";
+    } else if (PairCountWeightedCuts) {
+        // Without block counts every cut costs the same, so this only
+        // orders the cuts by the pairs they hit; nothing to estimate
+        CutCostReport Report;
+        computeCostWeightedHittingSet(AntiDepPaths_, PathWeights_, UnitCost(),
+                                      HittingSet_, Report);
+        if (isVerbose(SummaryOutput))
+            errs() << "Pair-count-weighted cuts: " << Report.Weighted
+                   << " cuts (unweighted " << Report.Unweighted << ")\n";
+    } else if (CutPriorityPolicy == LoopDepthCuts) {
+        computePriorityHittingSet(AntiDepPaths_, LI->getBase(),
+                                  LoopDepthPriority(), HittingSet_);
+    } else if (HaveBase_) {
+        repairHittingSet();
+    } else {
+        computeGreedyHittingSet(AntiDepPaths_, HittingSet_);
+    }
+}
 
-        // Load and store in different basic block
-        BasicBlock *curBB = StoreBB;
-        DomTreeNode *curDTNode = DT->getNode(StoreBB), *LoadDTNode = DT->getNode(LoadBB);
-        // loop until load is not 
-        while (DT->dominates(LoadDTNode, curDTNode)) {
-            errs() << "^^^^^ Current BB is " << curBB->getName() << "\n";
-            BasicBlock::iterator E;
-            // check if Load and current node in the same BB
-            if (curBB == LoadBB) {
-                E = Load;
-            } else {
-                E = curBB->begin();
-            }
-            // scan current BB
-            while(curInst != E) {
-                if (isa<StoreInst>(--curInst)) {
-                    newPath.push_back(curInst);
-                }
-            }
-            // find current Node's iDOM
-            curDTNode = curDTNode->getIDom();
-            if (curDTNode == NULL)
-                break;
-            curBB = curDTNode->getBlock();
-            curInst = curBB->end();
+bool idenRegion::useIncrementalCuts() const {
+    return IncrementalCuts && Cache_.enabled() && !ExactHittingSetMode &&
+           !ProfileWeightedCuts && !PairCountWeightedCuts &&
+           CutPriorityPolicy == PathCountCuts;
+}
+
+// The profile holds the pairs of the whole module.  Sort them out by function
+// once, so each function only looks at its own; a pair across two functions
+// is never anti-dependent.
+void idenRegion::bucketProfiledPairs() {
+    std::vector<uint64_t> Counts;
+    if (!MergedProfileFile.empty()) {
+        // The merged runs name the accesses by their -lamp-insts ids, which
+        // LAMPLoadProfile maps back to this module; ids it does not know
+        // belong to other bitcode and are dropped
+        typedef std::map<unsigned int, Instruction*> idToInstMapTy;
+        const idToInstMapTy &idToInst = LLP->IdToInstMap;
+        const DepCountRecord *Deps = DepProfile_.getDeps();
+        for (size_t i = 0, e = DepProfile_.getNumDeps(); i != e; ++i) {
+            idToInstMapTy::const_iterator Load = idToInst.find(Deps[i].Load);
+            idToInstMapTy::const_iterator Store = idToInst.find(Deps[i].Store);
+            if (Load == idToInst.end() || Store == idToInst.end())
+                continue;
+            addProfiledPair(Load->second, Store->second,
+                            (uint64_t)(Deps[i].Count + 0.5), Counts);
         }
-        errs() << "@@@ Inter BB: \n@@@ ";
-        printPath(newPath);
-        errs() << "\n";
+    } else {
+        typedef std::map<std::pair<Instruction*, Instruction*>*, unsigned int> dynamicDepMapTy;
+        const dynamicDepMapTy &dynamicDepMap = LLP->DepToTimesMap;
+        for (dynamicDepMapTy::const_iterator I = dynamicDepMap.begin(), E = dynamicDepMap.end(); I != E; I++)
+            addProfiledPair(I->first->first, I->first->second, I->second,
+                            Counts);
     }
-    
-    errs() << "Path cap is " << AntiDepPaths_.capacity() << "\n";
-    errs() << "Path size is " << AntiDepPaths_.size() << "\n";
-    errs() << "#########################################################\n";
-    errs() << "#################### Paths Summary ######################\n";
-    errs() << "#########################################################\n";
-    printCollection(AntiDepPaths_);
-    errs() << "\n";
+    MinTrustedCount_ = getPercentileCount(Counts, PairCountPercentile);
+    HaveProfiledPairs_ = true;
 }
 
-Instruction* idenRegion::findLargestCount(std::map<Instruction *, int> Map) {
-    // TODO: linear right now, optimize later
-    Instruction* temp_max;
-    int max = 0;
-    for (std::map<Instruction *, int>::iterator I = Map.begin(), E = Map.end(); I != E; I++) {
-        // exclude those in the hitting set
-        if (I->second > max) {
-            temp_max = I->first;
-            max = I->second;
-        }
+void idenRegion::addProfiledPair(Instruction *Load, Instruction *Store,
+                                 uint64_t Count,
+                                 std::vector<uint64_t> &Counts) {
+    Counts.push_back(Count);
+    Function *LoadF = Load->getParent()->getParent();
+    if (LoadF == Store->getParent()->getParent())
+        ProfiledPairs_[LoadF].push_back(
+            ProfiledPairTy(AntiDepPairTy(Load, Store), Count));
+}
+
+bool idenRegion::isTrustedCount(uint64_t Count) const {
+    return Count >= MinPairCount && Count >= MinTrustedCount_;
+}
+
+// Add the estimated dynamic regions of the cuts of F to the module totals.
+// A cut runs as often as its block, so there is no estimate without the
+// block counts.
+void idenRegion::accountRegions(Function &F) {
+    if (ProfileWeightedCuts) {
+        Regions_.Estimated = true;
+        for (SmallPtrSetTy::iterator I = HittingSet_.begin(),
+             E = HittingSet_.end(); I != E; I++)
+            Regions_.CutExecutions += BlockCounts_.lookup((*I)->getParent());
+        for (Function::iterator BB = F.begin(), E = F.end(); BB != E; ++BB)
+            Regions_.Instructions += BlockCounts_.lookup(BB) * BB->size();
     }
-    return temp_max;
+    TotalRegions_.add(Regions_);
+    if (isVerbose(SummaryOutput) && Regions_.Pairs)
+        Regions_.print(errs());
 }
 
-void idenRegion::computeHittingSet() {
-    std::vector<AntiDepPathTy> collectionPaths;
-    typedef std::map<Instruction *, int> instCountTy;
-    typedef std::map<Instruction *, std::set<int> > instPosTy; 
-    instCountTy instCount;
-    instPosTy instPos;
-    int index = 0;
-    for (AntiDepPaths::iterator I = AntiDepPaths_.begin(), E = AntiDepPaths_.end(); I != E; I++, index++) {
-        collectionPaths.push_back(*I);
-        errs() << "   " << index << ": ";
-        printPath(*I);
-        errs() << "\n";
-        // construct the map
-        for (AntiDepPathTy::iterator II = I->begin(), EE = I->end(); II != EE; II++) {
-            instCount[*II] += 1;
-            instPos[*II].insert(index);
-        }
+// Bring the cuts of the last analysis of this body (Base_) up to date with
+// the current paths rather than solving again: paths are matched as sets of
+// instruction indices, the old ones that are gone are removed, the new ones
+// added, and IncrementalHittingSet repairs the cuts.
+void idenRegion::repairHittingSet() {
+    IncrementalHittingSet Incremental(Numbering_.getNumInsts());
+    // Forced cuts stay; the rest of the old cuts may go.  Cuts before paths.
+    for (SmallPtrSetTy::iterator I = HittingSet_.begin(), E = HittingSet_.end(); I != E; I++)
+        Incremental.addCut(Numbering_.getIndex(*I), true);
+    for (unsigned i = 0, e = Base_.Cuts.size(); i != e; ++i)
+        Incremental.addCut(Base_.Cuts[i]);
+
+    typedef std::map<std::vector<unsigned>, std::vector<unsigned> > PathMapTy;
+    PathMapTy OldPaths;     // old path -> its handles
+    for (unsigned i = 0, e = Base_.Paths.size(); i != e; ++i) {
+        std::vector<unsigned> Key(Base_.Paths[i]);
+        std::sort(Key.begin(), Key.end());
+        Key.erase(std::unique(Key.begin(), Key.end()), Key.end());
+        OldPaths[Key].push_back(Incremental.addPath(Key.begin(), Key.end()));
     }
-    errs() << "~~~~ Inst Count Map:\n";
-    printMap(instCount);
-    errs() << "~~~~ Inst Position Map:\n";
-    printMap(instPos);
-    
-    // Generate the Hitting set based on Map information
-    int totalPaths = collectionPaths.size();
-    std::set<int> HittedSet;
-    while ((int)HittedSet.size() < totalPaths) {
-        bool increase = false;
-        int oldLen = HittedSet.size();
-        while (!increase) {
-            Instruction* maxCountInst = findLargestCount(instCount);
-            std::set<int> tempPos = instPos[maxCountInst];
-            for (std::set<int>::iterator I = tempPos.begin(), E = tempPos.end(); I != E; I++) {
-                HittedSet.insert(*I);
-            }
-            instCount.erase(maxCountInst);
-            if ((int)HittedSet.size() > oldLen) {
-                increase = true;
-                HittingSet_.insert(maxCountInst);
-            }
+    unsigned Kept = 0, Added = 0, Removed = 0;
+    for (AntiDepPaths::iterator I = AntiDepPaths_.begin(), E = AntiDepPaths_.end(); I != E; I++) {
+        std::vector<unsigned> Key;
+        for (AntiDepPathTy::iterator J = I->begin(), JE = I->end(); J != JE; J++)
+            Key.push_back(Numbering_.getIndex(*J));
+        std::sort(Key.begin(), Key.end());
+        Key.erase(std::unique(Key.begin(), Key.end()), Key.end());
+        PathMapTy::iterator Old = OldPaths.find(Key);
+        if (Old != OldPaths.end() && !Old->second.empty()) {
+            Old->second.pop_back();
+            ++Kept;
+        } else {
+            Incremental.addPath(Key.begin(), Key.end());
+            ++Added;
         }
     }
+    for (PathMapTy::iterator I = OldPaths.begin(), E = OldPaths.end(); I != E; I++)
+        for (unsigned i = 0, e = I->second.size(); i != e; ++i) {
+            Incremental.removePath(I->second[i]);
+            ++Removed;
+        }
+
+    Incremental.repair();
+    std::vector<unsigned> Cuts;
+    Incremental.getCuts(Cuts);
+    for (unsigned i = 0, e = Cuts.size(); i != e; ++i)
+        HittingSet_.insert(Numbering_.getInst(Cuts[i]));
+    if (isVerbose(SummaryOutput))
+        errs() << "Incremental cuts: " << Kept << " paths kept, " << Added
+               << " added, " << Removed << " removed; "
+               << Incremental.getNumAdded() << " cuts added, "
+               << Incremental.getNumDropped() << " dropped\n";
 }
 
 std::set<BasicBlock *> idenRegion::computeHittingSetinBB() {
@@ -601,4 +794,63 @@ std::set<BasicBlock *> idenRegion::computeHittingSetinBB() {
     return HittingSetBB;
 }
 
+// The trusted profiled pairs (with their counts under pair count weights), the
+// summaries of the callees and, with profile weights, the block counts feed
+// the analysis, so they are part of the cache key.
+// Without WithProfile the key names the last results for the body under any
+// profile, which -idem-incremental-cuts starts from.
+std::string idenRegion::getCacheOptions(Function &F, bool WithProfile) {
+    std::stringstream SS;
+    SS << getAnalysisOptionsKey(*this);
+    if (!WithProfile)
+        SS << " base";
+    else {
+        // The pairs come in the order of the profile's pointer-keyed map, so
+        // sort them by index to get the same key in every run
+        typedef std::pair<std::pair<unsigned, unsigned>, uint64_t> KeyPairTy;
+        std::vector<KeyPairTy> Pairs;
+        for (AntiDepPairs::iterator I = DynamicPairs_.begin(), E = DynamicPairs_.end(); I != E; I++) {
+            if (I->second->getParent()->getParent() != &F)
+                continue;
+            uint64_t Count = PairCountWeightedCuts ? PairCounts_.lookup(*I) : 0;
+            Pairs.push_back(KeyPairTy(std::make_pair(Numbering_.getIndex(I->first),
+                                                     Numbering_.getIndex(I->second)),
+                                      Count));
+        }
+        std::sort(Pairs.begin(), Pairs.end());
+        SS << " dynamic-pairs=";
+        for (unsigned i = 0, e = Pairs.size(); i != e; ++i) {
+            SS << Pairs[i].first.first << ":" << Pairs[i].first.second;
+            if (PairCountWeightedCuts)
+                SS << "x" << Pairs[i].second;
+            SS << ",";
+        }
+    }
+    SS << " callees=" << Summaries_->getCalleeKey(F);
+    if (WithProfile && ProfileWeightedCuts)
+        SS << " counts=" << getBlockCountKey(F, BlockCounts_);
+    return SS.str();
+}
+
+void idenRegion::printResult() {
+    if (HittingSet_.empty() || !isVerbose(SummaryOutput))
+        return;
+    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+    errs() << "!!!!! Hitting Set is !!!!!!\n";
+    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+    printHittingSet(HittingSet_);
+    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+    errs() << "!!!! Hitting Set BB is !!!!\n";
+    errs() << "!!!!!!!!!!!!!!!!!!!!!!!!!!!\n";
+    printSet(computeHittingSetinBB());
+}
 
+void idenRegion::cacheResult(uint64_t Key) {
+    if (!Cache_.enabled())
+        return;
+    CutSetCache::Entry E;
+    CutSetCache::save(Numbering_, AntiDepPairs_, AntiDepPaths_, HittingSet_, E);
+    Cache_.store(Key, E);
+    if (useIncrementalCuts())
+        Cache_.store(BaseKey_, E);
+}
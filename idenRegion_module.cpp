@@ -0,0 +1,368 @@
+//=============- idenRegion_module.cpp - Final Project for EECS 583 ---------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implement a module level driver for the Idenpotent Region
+// analysis.  The per-function work is split in two:
+//
+//   - on the main thread, one function at a time: dominator tree, loop info,
+//     memory buckets and every alias query the pair search needs
+//   - on a pool of worker threads: pair dataflow, paths and hitting set,
+//     which only read the IR and the per-function state built above
+//
+// Functions are processed in batches and the results of a batch are printed
+// in module order, so the output does not depend on the number of threads.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "idenRegion"
+#include <pthread.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+#include "llvm/Pass.h"
+#include "llvm/Module.h"
+#include "llvm/Function.h"
+#include "llvm/BasicBlock.h"
+#include "llvm/Instructions.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/Twine.h"
+#include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Analysis/AliasAnalysis.h"
+#include "llvm/Analysis/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Analysis/ProfileInfo.h"
+#include "AliasOracle.h"
+#include "FunctionSummaries.h"
+#include "MemoryAccess.h"
+#include "MemoryBuckets.h"
+#include "PriorityHittingSet.h"
+#include "AntiDepDataflow.h"
+#include "AntiDepAnalysis.h"
+#include "IdemOptions.h"
+
+using namespace llvm;
+
+// Functions prepared per round of worker threads; bounds the memory held by
+// precomputed alias rows.
+static const unsigned BatchSize = 256;
+
+//===----------------------------------------------------------------------===//
+// FunctionAnalysis
+//===----------------------------------------------------------------------===//
+namespace {
+    // Everything the analysis of one function needs and produces.  Built on
+    // the main thread, handed to exactly one worker, read back on the main
+    // thread once the whole batch is done.
+    struct FunctionAnalysis {
+        Function *F;
+        DominatorTree *DT;
+        LoopInfoBase<BasicBlock, Loop> *LI;
+        AntiDepDataflow *Engine;    // holds the precomputed alias rows
+        SmallVector<Instruction *, 8> WritingCalls;
+
+        AntiDepPairList Pairs;
+        AntiDepPathList Paths;
+        AntiDepHittingSet HittingSet;
+        HittingSetBound Bound;      // with -idem-exact-hitting-set
+        BlockCountMap Counts;       // with -idem-profile-weights
+        CutCostReport Cost;
+        PathReductionStats Reduction;   // with -idem-reduce-paths
+
+        explicit FunctionAnalysis(Function *Fn)
+            : F(Fn), DT(0), LI(0), Engine(0) {}
+        ~FunctionAnalysis() {
+            delete Engine;
+            delete LI;
+            delete DT;
+        }
+
+        // The part that runs on a worker thread.
+        void analyze() {
+            Engine->finish(Pairs);
+            delete Engine;
+            Engine = 0;
+            // Nothing to cut is trivially a minimum.
+            Bound.Optimal = true;
+            if (Pairs.empty())
+                return;
+            DomPathIndex Index;
+            Index.build(*F, *DT, WritingCalls);
+            computeAntiDepPaths(Index, Pairs, Paths,
+                                ReducePaths ? &Reduction : 0);
+            if (ExactHittingSetMode)
+                computeExactHittingSet(Paths, HittingSet, Bound);
+            else if (ProfileWeightedCuts)
+                computeWeightedHittingSet(Paths, Counts, HittingSet, Cost);
+            else if (CutPriorityPolicy == LoopDepthCuts)
+                computePriorityHittingSet(Paths, *LI, LoopDepthPriority(),
+                                          HittingSet);
+            else
+                computeGreedyHittingSet(Paths, HittingSet);
+        }
+
+     private:
+        FunctionAnalysis(const FunctionAnalysis &);
+        void operator=(const FunctionAnalysis &);
+    };
+
+    // Work shared by the threads of one batch.
+    struct WorkQueue {
+        std::vector<FunctionAnalysis *> *Work;
+        unsigned Next;
+        pthread_mutex_t Lock;
+    };
+}
+
+static void *runWorker(void *Arg) {
+    WorkQueue *Queue = static_cast<WorkQueue *>(Arg);
+    for (;;) {
+        pthread_mutex_lock(&Queue->Lock);
+        unsigned Index = Queue->Next++;
+        pthread_mutex_unlock(&Queue->Lock);
+        if (Index >= Queue->Work->size())
+            return 0;
+        (*Queue->Work)[Index]->analyze();
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// idenRegion-module
+//===----------------------------------------------------------------------===//
+namespace {
+    struct idenRegionModule : public ModulePass {
+        static char ID; // Pass identification, replacement for typeid
+
+        AliasAnalysis *AA;       // Current AliasAnalysis information
+        FunctionSummaries *Summaries_;  // What calls read, write and force
+        ProfileInfo *PI;         // Block counts with -idem-profile-weights
+        MergedBlockCounts MergedCounts_; // ... or from -idem-profile-file
+        AliasOracle Oracle_;     // Memoized load/store alias queries
+        MemoryBuckets Buckets_;  // Loads/stores grouped by underlying object
+
+        // Module totals
+        unsigned NumFunctions_, NumPairs_, NumPaths_, NumCuts_, NumCutBBs_;
+        // ... of the path cuts with -idem-exact-hitting-set
+        unsigned NumExactCuts_, NumGreedyCuts_, NumLowerBound_, NumOptimal_;
+        // ... of the estimated cut executions with -idem-profile-weights
+        double WeightedCost_, UnweightedCost_;
+        // ... of the paths dropped by -idem-reduce-paths
+        unsigned NumDuplicatePaths_, NumSubsumedPaths_;
+
+        idenRegionModule() : ModulePass(ID), Summaries_(0), PI(0) {}
+
+        void getAnalysisUsage(AnalysisUsage &AU) const {
+            AU.addRequired<AliasAnalysis>();
+            AU.addRequired<FunctionSummaries>();
+            if (ProfileWeightedCuts && MergedProfileFile.empty())
+                AU.addRequired<ProfileInfo>();
+            AU.setPreservesAll();
+        }
+
+        virtual bool runOnModule(Module &M);
+
+        //===----------------------------------------------------------------------===//
+        // Helpers
+        //===----------------------------------------------------------------------===//
+        FunctionAnalysis *prepare(Function &F);
+        void runBatch(std::vector<FunctionAnalysis *> &Batch, unsigned Threads);
+        void report(const FunctionAnalysis &FA);
+    };
+}
+
+char idenRegionModule::ID = 0;
+static RegisterPass<idenRegionModule> X("idenRegion-module", "EECS 583 project", false, false);
+
+bool idenRegionModule::runOnModule(Module &M) {
+    AA = &getAnalysis<AliasAnalysis>();
+    Summaries_ = &getAnalysis<FunctionSummaries>();
+    PI = ProfileWeightedCuts && MergedProfileFile.empty()
+         ? &getAnalysis<ProfileInfo>() : 0;
+    std::string Error;
+    if (ProfileWeightedCuts && !MergedProfileFile.empty() &&
+        !MergedCounts_.load(MergedProfileFile.c_str(), M, Error))
+        report_fatal_error(Error);
+    NumFunctions_ = NumPairs_ = NumPaths_ = NumCuts_ = NumCutBBs_ = 0;
+    NumExactCuts_ = NumGreedyCuts_ = NumLowerBound_ = NumOptimal_ = 0;
+    WeightedCost_ = UnweightedCost_ = 0;
+    NumDuplicatePaths_ = NumSubsumedPaths_ = 0;
+
+    unsigned Threads = AnalysisThreads;
+    if (Threads == 0) {
+        long CPUs = sysconf(_SC_NPROCESSORS_ONLN);
+        Threads = CPUs > 0 ? CPUs : 1;
+    }
+
+    std::vector<FunctionAnalysis *> Batch;
+    for (Module::iterator F = M.begin(), E = M.end(); F != E; ++F) {
+        if (F->isDeclaration())
+            continue;
+        Batch.push_back(prepare(*F));
+        if (Batch.size() == BatchSize)
+            runBatch(Batch, Threads);
+    }
+    runBatch(Batch, Threads);
+
+    if (!isVerbose(SummaryOutput))
+        return false;
+    errs() << "---------------------------------------------\n";
+    errs() << NumFunctions_ << " functions, " << NumPairs_ << " pairs, "
+           << NumPaths_ << " paths, " << NumCuts_ << " cuts in "
+           << NumCutBBs_ << " BBs\n";
+    if (isVerbose(TraceOutput))
+        errs() << "Analysis threads: " << Threads << "\n";
+    if (ReducePaths)
+        errs() << "Path reduction: " << NumDuplicatePaths_ << " duplicate, "
+               << NumSubsumedPaths_ << " subsumed paths dropped\n";
+    if (ExactHittingSetMode)
+        errs() << "Exact hitting set: " << NumExactCuts_
+               << " path cuts (greedy " << NumGreedyCuts_ << "), lower bound "
+               << NumLowerBound_ << ", " << NumOptimal_ << " of "
+               << NumFunctions_ << " functions optimal\n";
+    else if (ProfileWeightedCuts)
+        errs() << "Profile-weighted cuts: " << WeightedCost_
+               << " estimated dynamic cut executions (unweighted "
+               << UnweightedCost_ << ")\n";
+    return false;
+}
+
+// Everything that needs AA or builds analyses happens here, serially.
+FunctionAnalysis *idenRegionModule::prepare(Function &F) {
+    FunctionAnalysis *FA = new FunctionAnalysis(&F);
+
+    FA->DT = new DominatorTree();
+    FA->DT->runOnFunction(F);
+    FA->LI = new LoopInfoBase<BasicBlock, Loop>();
+    FA->LI->Calculate(FA->DT->getBase());
+
+    Oracle_.reset(AA, Summaries_);
+    Buckets_.build(F, AA->getTargetData());
+    Summaries_->forceCuts(F, FA->HittingSet);
+    if (MergedCounts_.loaded())
+        MergedCounts_.getBlockCounts(F, FA->Counts);
+    else if (PI)
+        getBlockCounts(*PI, F, FA->Counts);
+
+    // Stores, memory intrinsics and writing calls; volatile and atomic
+    // stores are isolated by forced cuts
+    SmallVector<Instruction *, 32> Stores;
+    for (Function::iterator BB = F.begin(); BB != F.end(); ++BB)
+        for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ++I)
+            if (isMemoryWriter(I)) {
+                Stores.push_back(I);
+            } else if (Oracle_.isWritingCall(I)) {
+                Stores.push_back(I);
+                FA->WritingCalls.push_back(I);
+            }
+
+    FA->Engine = new AntiDepDataflow(Oracle_, Buckets_, AA);
+    FA->Engine->prepare(F, Stores);
+    return FA;
+}
+
+// Analyze a batch on the thread pool, then report it in module order.
+void idenRegionModule::runBatch(std::vector<FunctionAnalysis *> &Batch,
+                                unsigned Threads) {
+    if (Batch.empty())
+        return;
+
+    if (Threads > Batch.size())
+        Threads = Batch.size();
+    if (Threads <= 1) {
+        for (unsigned i = 0, e = Batch.size(); i != e; ++i)
+            Batch[i]->analyze();
+    } else {
+        WorkQueue Queue;
+        Queue.Work = &Batch;
+        Queue.Next = 0;
+        pthread_mutex_init(&Queue.Lock, NULL);
+
+        std::vector<pthread_t> Workers;
+        for (unsigned t = 0; t != Threads; ++t) {
+            pthread_t Worker;
+            if (pthread_create(&Worker, NULL, runWorker, &Queue) != 0)
+                break;
+            Workers.push_back(Worker);
+        }
+        // Out of threads: this one stands in for the missing workers
+        if (Workers.size() < Threads)
+            runWorker(&Queue);
+        for (unsigned t = 0, e = Workers.size(); t != e; ++t)
+            pthread_join(Workers[t], NULL);
+        pthread_mutex_destroy(&Queue.Lock);
+    }
+
+    for (unsigned i = 0, e = Batch.size(); i != e; ++i) {
+        report(*Batch[i]);
+        delete Batch[i];
+    }
+    Batch.clear();
+}
+
+// Print one function's result.  Cuts are listed in instruction order, not in
+// set order, so the output is stable from run to run.
+void idenRegionModule::report(const FunctionAnalysis &FA) {
+    bool Verbose = isVerbose(SummaryOutput);
+    std::string Cuts, CutBBs;
+    unsigned NumCuts = 0, NumCutBBs = 0;
+    for (Function::iterator BB = FA.F->begin(); BB != FA.F->end(); ++BB) {
+        bool CutBB = false;
+        unsigned Offset = 0;
+        for (BasicBlock::iterator I = BB->begin(); I != BB->end(); ++I) {
+            ++Offset;
+            if (!FA.HittingSet.count(I))
+                continue;
+            if (Verbose)
+                Cuts += (Twine(NumCuts ? ", " : "") + BB->getName() + ":" +
+                         Twine(Offset)).str();
+            ++NumCuts;
+            CutBB = true;
+        }
+        if (!CutBB)
+            continue;
+        if (Verbose)
+            CutBBs += (NumCutBBs ? ", " : "") + BB->getName().str();
+        ++NumCutBBs;
+    }
+
+    if (Verbose) {
+        errs() << "##### " << FA.F->getName() << ": " << FA.Pairs.size()
+               << " pairs, " << FA.Paths.size() << " paths\n";
+        errs() << "Hitting Set: [ " << Cuts << " ]\n";
+        errs() << "Hitting Set BB: [ " << CutBBs << " ]\n";
+        if (FA.Reduction.Paths)
+            errs() << "Path reduction: " << FA.Reduction.Paths << " paths, "
+                   << FA.Reduction.Duplicates << " duplicate, "
+                   << FA.Reduction.Subsumed << " subsumed\n";
+        if (ExactHittingSetMode)
+            errs() << "Exact hitting set: " << FA.Bound.Cuts << " cuts (greedy "
+                   << FA.Bound.Greedy << "), lower bound "
+                   << FA.Bound.LowerBound
+                   << (FA.Bound.Optimal ? ", optimal" : ", budget exhausted")
+                   << "\n";
+        else if (ProfileWeightedCuts)
+            errs() << "Profile-weighted cuts: " << FA.Cost.Weighted
+                   << " estimated dynamic cut executions (unweighted "
+                   << FA.Cost.Unweighted << ")\n";
+    }
+
+    ++NumFunctions_;
+    NumPairs_ += FA.Pairs.size();
+    NumPaths_ += FA.Paths.size();
+    NumCuts_ += NumCuts;
+    NumCutBBs_ += NumCutBBs;
+    NumExactCuts_ += FA.Bound.Cuts;
+    NumGreedyCuts_ += FA.Bound.Greedy;
+    NumLowerBound_ += FA.Bound.LowerBound;
+    NumOptimal_ += FA.Bound.Optimal;
+    WeightedCost_ += FA.Cost.Weighted;
+    UnweightedCost_ += FA.Cost.Unweighted;
+    NumDuplicatePaths_ += FA.Reduction.Duplicates;
+    NumSubsumedPaths_ += FA.Reduction.Subsumed;
+}
@@ -20,12 +20,15 @@ opt -mem2reg < $fname.ls.bc > $fname.m2r.bc || { echo "Failed to convert SSA"; e
 opt -load $pass_root/Debug+Asserts/lib/$class_name.so -gvn -enable-pre2 -enable-load-pre2 < $fname.m2r.bc > $fname.pre.bc || { echo "Fail to GVN"; exit 1; }
 # opt -load $pass_root/Debug+Asserts/lib/$class_name.so -enable-pre2 -enable-load-pre2 < $fname.pre.temp.bc > $fname.pre.bc || ( echo "Fail to PRE"; exit 1; )
 
-opt -insert-edge-profiling $fname.pre.bc -o $fname.profile.ls.bc
+opt -insert-edge-profiling $fname.pre.bc -o $fname.profile.ls.bc || { echo "Failed to insert edge profiling"; exit 1; }
 
 llc $fname.profile.ls.bc -o $fname.profile.ls.s
 
 g++ -o $fname.profile $fname.profile.ls.s $llvm_path/Debug+Asserts/lib/libprofile_rt.so
 
+# one run, on the same input as the LAMP run below, so the edge counts and
+# the dependences come from the same input; several inputs are merged with
+# tools/mergeProfiles and read with -idem-profile-file instead
 ./$fname.profile $2
 
 # LAMP profile
@@ -38,11 +41,15 @@ g++ -o $fname.lamp.exe $fname.lamp.s  $pass_root/tools/lamp-profiler/lamp_hooks.
 ./$fname.lamp.exe $2
 
 
+# cuts weighted by the block counts only with WEIGHTS=1
+weights=
+[ "$WEIGHTS" = 1 ] && weights=-idem-profile-weights
+
 # create dot file
 opt -dot-cfg $fname.pre.bc >& /dev/null
 
 # load our pass
-opt -load $pass_root/Debug+Asserts/lib/$class_name.so -lamp-inst-cnt -lamp-map-loop -lamp-load-profile -profile-loader -profile-info-file=llvmprof.out -$pass_name < $fname.pre.bc > $fname.idenregion.bc || { echo "Fail to opt-load idenRegion"; exit 1; }
+opt -load $pass_root/Debug+Asserts/lib/$class_name.so -lamp-inst-cnt -lamp-map-loop -lamp-load-profile -profile-loader -profile-info-file=llvmprof.out -$pass_name $weights < $fname.pre.bc > $fname.idenregion.bc || { echo "Fail to opt-load idenRegion"; exit 1; }
 
 
 llc $fname.idenregion.bc -o $fname.idenregion.s 
@@ -13,14 +13,6 @@ clang -emit-llvm -o $fname.bc -c $fname.c || { echo "Failed to emit llvm bc"; ex
 
 opt -loop-simplify < $fname.bc > $fname.ls.bc || { echo "Failed to opt loop simplify"; exit 1; }
 
-opt -insert-edge-profiling $fname.ls.bc -o $fname.profile.ls.bc
-
-llc $fname.profile.ls.bc -o $fname.profile.ls.s
-
-g++ -o $fname.profile $fname.profile.ls.s $llvm_path/Debug+Asserts/lib/libprofile_rt.so
-
-./$fname.profile $2
-
 # convert to SSA form
 opt -mem2reg < $fname.ls.bc > $fname.m2r.bc || { echo "Failed to convert SSA"; exit 1; }
 
@@ -28,10 +20,40 @@ opt -mem2reg < $fname.ls.bc > $fname.m2r.bc || { echo "Failed to convert SSA"; e
 opt -load $pass_root/Debug+Asserts/lib/$class_name.so -gvn -enable-pre2 -enable-load-pre2 < $fname.m2r.bc > $fname.pre.bc || { echo "Fail to GVN"; exit 1; }
 # opt -load $pass_root/Debug+Asserts/lib/$class_name.so -enable-pre2 -enable-load-pre2 < $fname.pre.temp.bc > $fname.pre.bc || ( echo "Fail to PRE"; exit 1; )
 
+# edge profile of the bitcode the pass analyzes, so block counts line up
+opt -insert-edge-profiling $fname.pre.bc -o $fname.profile.ls.bc || { echo "Failed to insert edge profiling"; exit 1; }
+
+llc $fname.profile.ls.bc -o $fname.profile.ls.s
+
+g++ -o $fname.profile $fname.profile.ls.s $llvm_path/Debug+Asserts/lib/libprofile_rt.so
+
+# one run per input given after the file name; the runs of several inputs
+# are merged into $fname.idemprof, which the pass reads instead of llvmprof.out
+inputs=("${@:2}")
+profile_args="-profile-loader -profile-info-file=llvmprof.out"
+if [ ${#inputs[@]} -le 1 ]; then
+    ./$fname.profile $2
+else
+    make -C $pass_root/tools mergeProfiles > /dev/null || { echo "Failed to build mergeProfiles"; exit 1; }
+    runs=()
+    for i in "${!inputs[@]}"; do
+        rm -f llvmprof.out
+        ./$fname.profile ${inputs[$i]}
+        mv llvmprof.out $fname.run$i.prof
+        runs+=($fname.run$i.prof)
+    done
+    $pass_root/tools/mergeProfiles -o $fname.idemprof -llvmprof llvmprof.out "${runs[@]}" || { echo "Failed to merge profiles"; exit 1; }
+    profile_args="-idem-profile-file=$fname.idemprof"
+fi
+
+# cuts weighted by the block counts only with WEIGHTS=1
+weights=
+[ "$WEIGHTS" = 1 ] && weights=-idem-profile-weights
+
 # create dot file
 opt -dot-cfg $fname.pre.bc >& /dev/null
 
-opt -load $pass_root/Debug+Asserts/lib/$class_name.so -$pass_name < $fname.pre.bc > $fname.idenregion.bc || { echo "Fail to opt-load idenRegion"; exit 1; }
+opt -load $pass_root/Debug+Asserts/lib/$class_name.so $profile_args -$pass_name $weights < $fname.pre.bc > $fname.idenregion.bc || { echo "Fail to opt-load idenRegion"; exit 1; }
 
 
 llc $fname.idenregion.bc -o $fname.idenregion.s 
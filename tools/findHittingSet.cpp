@@ -0,0 +1,114 @@
+//===-- findHittingSet.cpp - Hitting set of sets read from a file ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Command line front end to the hittingSet.cpp library.  Reads one set per
+// line, as whitespace separated unsigned ids (blank lines and lines starting
+// with '#' are skipped), and prints the ids of a greedy hitting set in the
+// order they were taken.  Sizes go to stderr.
+//
+//   g++ -O2 -I.. findHittingSet.cpp ../hittingSet.cpp -o findHittingSet
+//   printf '5\n3 5 7\n5 7 9\n' | ./findHittingSet
+//
+// The input is held as flat arrays and the solver runs in one block sized up
+// front, so memory is linear in the number of ids read.
+//
+//===----------------------------------------------------------------------===//
+
+#include "HittingSet.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace llvm;
+
+// Append the ids on Line to Ids.  Returns false on anything that is not an
+// unsigned number.
+static bool parseLine(const char *Line, std::vector<unsigned> &Ids) {
+    for (;;) {
+        while (isspace((unsigned char)*Line))
+            ++Line;
+        if (!*Line)
+            return true;
+        if (!isdigit((unsigned char)*Line))
+            return false;
+        char *End;
+        errno = 0;
+        unsigned long Id = strtoul(Line, &End, 10);
+        if (errno || Id > ~0U)
+            return false;
+        Ids.push_back(Id);
+        Line = End;
+    }
+}
+
+int main(int argc, char **argv) {
+    FILE *In = stdin;
+    if (argc > 2 || (argc == 2 && !strcmp(argv[1], "-h"))) {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2 && !(In = fopen(argv[1], "r"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    // Sets in CSR form over the ids as read.
+    std::vector<unsigned> Start(1, 0), Nodes;
+    std::vector<char> Line(4096);
+    unsigned LineNo = 0;
+    while (fgets(&Line[0], Line.size(), In)) {
+        while (!strchr(&Line[0], '\n') && !feof(In)) {
+            size_t Len = strlen(&Line[0]);
+            Line.resize(Line.size() * 2);
+            if (!fgets(&Line[Len], Line.size() - Len, In))
+                break;
+        }
+        ++LineNo;
+        const char *P = &Line[0];
+        while (isspace((unsigned char)*P))
+            ++P;
+        if (!*P || *P == '#')
+            continue;
+        if (!parseLine(P, Nodes)) {
+            fprintf(stderr, "line %u: expected unsigned ids\n", LineNo);
+            return 1;
+        }
+        Start.push_back(Nodes.size());
+    }
+    if (In != stdin)
+        fclose(In);
+
+    // Renumber the ids densely.
+    std::vector<unsigned> Ids(Nodes);
+    std::sort(Ids.begin(), Ids.end());
+    Ids.erase(std::unique(Ids.begin(), Ids.end()), Ids.end());
+    for (unsigned i = 0, e = Nodes.size(); i != e; ++i)
+        Nodes[i] = std::lower_bound(Ids.begin(), Ids.end(), Nodes[i]) -
+                   Ids.begin();
+
+    SetCollection Sets = { (unsigned)Ids.size(), (unsigned)Start.size() - 1,
+                           &Start[0], Nodes.empty() ? 0 : &Nodes[0] };
+    size_t Size = getHittingSetArenaSize(Sets);
+    std::vector<char> Mem(Size);
+    HittingSetArena Arena(&Mem[0], Size);
+    std::vector<unsigned> Picks(Ids.size() + 1);
+    unsigned NumPicks = findHittingSet(Sets, Arena, &Picks[0]);
+
+    for (unsigned i = 0; i != NumPicks; ++i)
+        printf("%s%u", i ? " " : "", Ids[Picks[i]]);
+    printf("\n");
+    fprintf(stderr, "%u sets, %zu ids, %zu incidences: %u picks, "
+            "%zu arena bytes\n", Sets.NumSets, Ids.size(), Nodes.size(),
+            NumPicks, Arena.getUsed());
+    return 0;
+}
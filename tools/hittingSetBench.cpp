@@ -0,0 +1,439 @@
+//===-- hittingSetBench.cpp - Hitting set engine benchmark ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Times the hitting set engines on synthetic instances shaped like the paths
+// of a large function, without an opt run.  Candidates are writers in
+// program order; a path is a store plus writers above it.  The shape is
+// controlled by:
+//
+//   -paths N        number of paths (100000)
+//   -candidates N   number of writers (20000)
+//   -length N       longest path; lengths are uniform in 1..N (16)
+//   -overlap P      chance that each writer above the store is on the path,
+//                   so lower values spread paths over more writers (0.75)
+//   -hot P          chance that a member is instead drawn from a power law
+//                   over all writers, like a store in a hot loop (0)
+//   -zipf S         exponent of that power law (1.0)
+//   -seed N         random seed (1)
+//
+// and the engines run are chosen with -run, a comma separated list of:
+//
+//   map      the loop the passes used before the heap engine (std::map
+//            counts and std::set positions, counts fixed at the start)
+//   heap     GreedyHittingSet, -idem-hitting-set-engine=heap
+//   bitset   BitsetHittingSet, -idem-hitting-set-engine=bitset
+//   arena    the CSR library of hittingSet.cpp, -idem-hitting-set-engine=arena
+//   sets     the same through findHittingSet(set<set<unsigned> >), counting
+//            the conversion to sets (which also merges duplicate paths)
+//   reduce   reducePaths() then the heap, as with -idem-reduce-paths
+//   weighted the heap with a synthetic profile, as with
+//            -idem-profile-weights: candidate costs and path weights drawn
+//            log-uniformly from 1..1000 like block and pair counts
+//   exact    ExactHittingSet with the -exact-budget-ms budget (1000)
+//
+// (default: all but map, which is quadratic).  The priority engine needs
+// LLVM instructions and is not covered.
+//
+// Every engine runs in a child process, so the peak memory reported is its
+// own: the high-water resident size above what the instance already took.
+// heap, bitset and arena must pick the same cuts; the tool fails if they do
+// not.
+//
+//===----------------------------------------------------------------------===//
+
+#include "BitsetHittingSet.h"
+#include "ExactHittingSet.h"
+#include "GreedyHittingSet.h"
+#include "HittingSet.h"
+#include "PathReduction.h"
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace llvm;
+
+typedef std::vector<std::vector<unsigned> > PathsTy;
+
+namespace {
+struct ShapeTy {
+    unsigned Paths, Candidates, Length, Seed;
+    double Overlap, Hot, Zipf;
+};
+
+// What a child reports back about one engine run.
+struct ResultTy {
+    double MS;
+    long PeakKB;
+    unsigned Cuts;
+    uint64_t Hash;          // of the sorted cuts
+    unsigned LowerBound;    // exact only
+    int Optimal;            // exact only
+};
+
+// xorshift64*, so instances do not depend on the C library's rand().
+class Random {
+ public:
+    explicit Random(uint64_t Seed)
+        : State_(Seed * 2685821657736338717ULL | 1) {}
+    uint64_t next() {
+        State_ ^= State_ >> 12;
+        State_ ^= State_ << 25;
+        State_ ^= State_ >> 27;
+        return State_ * 2685821657736338717ULL;
+    }
+    unsigned below(unsigned N) { return next() % N; }
+    double unit() { return (next() >> 11) * (1.0 / 9007199254740992.0); }
+
+ private:
+    uint64_t State_;
+};
+}
+
+static double now() {
+    struct timeval TV;
+    gettimeofday(&TV, 0);
+    return TV.tv_sec + TV.tv_usec * 1e-6;
+}
+
+static long getResidentKB() {
+    long Pages = 0, Resident = 0;
+    if (FILE *F = fopen("/proc/self/statm", "r")) {
+        if (fscanf(F, "%ld %ld", &Pages, &Resident) != 2)
+            Resident = 0;
+        fclose(F);
+    }
+    return Resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+static void generate(const ShapeTy &Shape, PathsTy &Paths) {
+    Random R(Shape.Seed);
+
+    // Power law over the writers: rank k is drawn with weight 1/k^Zipf, and
+    // ranks are dealt to writers at random.
+    std::vector<double> CDF;
+    std::vector<unsigned> Rank;
+    if (Shape.Hot > 0) {
+        double Sum = 0;
+        for (unsigned k = 0; k != Shape.Candidates; ++k) {
+            Sum += 1.0 / pow(k + 1.0, Shape.Zipf);
+            CDF.push_back(Sum);
+            Rank.push_back(k);
+        }
+        for (unsigned k = Shape.Candidates; k > 1; --k)
+            std::swap(Rank[k - 1], Rank[R.below(k)]);
+    }
+
+    Paths.resize(Shape.Paths);
+    for (unsigned i = 0; i != Shape.Paths; ++i) {
+        std::vector<unsigned> &Path = Paths[i];
+        unsigned Store = R.below(Shape.Candidates);
+        unsigned Length = 1 + R.below(Shape.Length);
+        Path.push_back(Store);
+        for (unsigned c = Store; c-- != 0 && Path.size() < Length; ) {
+            if (R.unit() >= Shape.Overlap)
+                continue;
+            if (Shape.Hot > 0 && R.unit() < Shape.Hot) {
+                double U = R.unit() * CDF.back();
+                Path.push_back(Rank[std::upper_bound(CDF.begin(), CDF.end(),
+                                                     U) - CDF.begin()]);
+            } else {
+                Path.push_back(c);
+            }
+        }
+    }
+}
+
+// The loop idenRegion used before the heap engine, over ids instead of
+// instructions.
+static unsigned findLargestCount(std::map<unsigned, int> Map) {
+    unsigned Max = 0;
+    int MaxCount = 0;
+    for (std::map<unsigned, int>::iterator I = Map.begin(), E = Map.end();
+         I != E; ++I)
+        if (I->second > MaxCount) {
+            Max = I->first;
+            MaxCount = I->second;
+        }
+    return Max;
+}
+
+static void solveMap(const PathsTy &Paths, std::vector<unsigned> &Picks) {
+    std::map<unsigned, int> Count;
+    std::map<unsigned, std::set<int> > Pos;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        for (unsigned j = 0, je = Paths[i].size(); j != je; ++j) {
+            Count[Paths[i][j]] += 1;
+            Pos[Paths[i][j]].insert(i);
+        }
+    std::set<int> Hit;
+    while (Hit.size() < Paths.size() && !Count.empty()) {
+        unsigned Max = findLargestCount(Count);
+        unsigned OldSize = Hit.size();
+        Hit.insert(Pos[Max].begin(), Pos[Max].end());
+        if (Hit.size() > OldSize)
+            Picks.push_back(Max);
+        Count.erase(Max);
+    }
+}
+
+template <typename SolverT>
+static void solve(unsigned NumCandidates, const PathsTy &Paths,
+                  std::vector<unsigned> &Picks) {
+    SolverT Solver(NumCandidates);
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        Solver.addPath(Paths[i].begin(), Paths[i].end());
+    Solver.solve(Picks);
+}
+
+static void solveArena(unsigned NumCandidates, const PathsTy &Paths,
+                       std::vector<unsigned> &Picks) {
+    std::vector<unsigned> Start(1, 0), Nodes;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i) {
+        Nodes.insert(Nodes.end(), Paths[i].begin(), Paths[i].end());
+        Start.push_back(Nodes.size());
+    }
+    SetCollection Sets = { NumCandidates, (unsigned)Paths.size(), &Start[0],
+                           &Nodes[0] };
+    std::vector<char> Mem(getHittingSetArenaSize(Sets));
+    HittingSetArena Arena(&Mem[0], Mem.size());
+    Picks.resize(NumCandidates);
+    Picks.resize(findHittingSet(Sets, Arena, &Picks[0]));
+}
+
+static void solveSets(const PathsTy &Paths, std::vector<unsigned> &Picks) {
+    std::set<std::set<unsigned> > Collection;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        Collection.insert(std::set<unsigned>(Paths[i].begin(),
+                                             Paths[i].end()));
+    std::set<unsigned> Result = findHittingSet(Collection);
+    Picks.assign(Result.begin(), Result.end());
+}
+
+static void solveReduced(unsigned NumCandidates, const PathsTy &Paths,
+                         std::vector<unsigned> &Picks) {
+    PathReductionStats Stats;
+    std::vector<char> Keep;
+    reducePaths(Paths, NumCandidates, Keep, Stats);
+    PathsTy Reduced;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        if (Keep[i])
+            Reduced.push_back(Paths[i]);
+    solve<GreedyHittingSet>(NumCandidates, Reduced, Picks);
+}
+
+// N counts log-uniform over 1..1000, from their own stream so the paths do
+// not change with them.
+static void generateCounts(uint64_t Seed, unsigned N,
+                           std::vector<double> &Counts) {
+    Random R(Seed);
+    Counts.resize(N);
+    for (unsigned i = 0; i != N; ++i)
+        Counts[i] = pow(1000.0, R.unit());
+}
+
+static void solveWeighted(unsigned NumCandidates, const PathsTy &Paths,
+                          const std::vector<double> &Costs,
+                          const std::vector<double> &Weights,
+                          std::vector<unsigned> &Picks) {
+    GreedyHittingSet Solver(NumCandidates);
+    for (unsigned c = 0; c != NumCandidates; ++c)
+        Solver.setCost(c, Costs[c]);
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        Solver.addPath(Paths[i].begin(), Paths[i].end(), Weights[i]);
+    Solver.solve(Picks);
+}
+
+static void run(const std::string &Engine, const ShapeTy &Shape,
+                unsigned BudgetMS, const PathsTy &Paths, ResultTy &Result) {
+    std::vector<double> Costs, Weights;
+    if (Engine == "weighted") {
+        generateCounts(Shape.Seed * 3 + 1, Shape.Candidates, Costs);
+        generateCounts(Shape.Seed * 3 + 2, Paths.size(), Weights);
+    }
+    long Base = getResidentKB();
+    std::vector<unsigned> Picks;
+    Result.LowerBound = 0;
+    Result.Optimal = 0;
+    double T0 = now();
+    if (Engine == "map") {
+        solveMap(Paths, Picks);
+    } else if (Engine == "heap") {
+        solve<GreedyHittingSet>(Shape.Candidates, Paths, Picks);
+    } else if (Engine == "bitset") {
+        solve<BitsetHittingSet>(Shape.Candidates, Paths, Picks);
+    } else if (Engine == "arena") {
+        solveArena(Shape.Candidates, Paths, Picks);
+    } else if (Engine == "sets") {
+        solveSets(Paths, Picks);
+    } else if (Engine == "reduce") {
+        solveReduced(Shape.Candidates, Paths, Picks);
+    } else if (Engine == "weighted") {
+        solveWeighted(Shape.Candidates, Paths, Costs, Weights, Picks);
+    } else {
+        ExactHittingSet Solver(Shape.Candidates);
+        for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+            Solver.addPath(Paths[i].begin(), Paths[i].end());
+        Result.Optimal = Solver.solve(BudgetMS, Picks);
+        Result.LowerBound = Solver.getLowerBound();
+    }
+    Result.MS = (now() - T0) * 1e3;
+
+    struct rusage Usage;
+    getrusage(RUSAGE_SELF, &Usage);
+    Result.PeakKB = Usage.ru_maxrss > Base ? Usage.ru_maxrss - Base : 0;
+    Result.Cuts = Picks.size();
+    std::sort(Picks.begin(), Picks.end());
+    Result.Hash = 14695981039346656037ULL;
+    for (unsigned i = 0, e = Picks.size(); i != e; ++i)
+        Result.Hash = (Result.Hash ^ Picks[i]) * 1099511628211ULL;
+}
+
+// Run Engine in a child and read its result back.  Returns false if the
+// child failed.
+static bool runInChild(const std::string &Engine, const ShapeTy &Shape,
+                       unsigned BudgetMS, const PathsTy &Paths,
+                       ResultTy &Result) {
+    int Pipe[2];
+    if (pipe(Pipe))
+        return false;
+    fflush(stdout);
+    pid_t Child = fork();
+    if (Child < 0) {
+        close(Pipe[0]);
+        close(Pipe[1]);
+        return false;
+    }
+    if (Child == 0) {
+        close(Pipe[0]);
+        run(Engine, Shape, BudgetMS, Paths, Result);
+        ssize_t Written = write(Pipe[1], &Result, sizeof(Result));
+        _exit(Written == (ssize_t)sizeof(Result) ? 0 : 1);
+    }
+    close(Pipe[1]);
+    ssize_t Read = read(Pipe[0], &Result, sizeof(Result));
+    close(Pipe[0]);
+    int Status;
+    waitpid(Child, &Status, 0);
+    return Read == (ssize_t)sizeof(Result) && WIFEXITED(Status) &&
+           WEXITSTATUS(Status) == 0;
+}
+
+static bool isEngine(const std::string &Engine) {
+    return Engine == "map" || Engine == "heap" || Engine == "bitset" ||
+           Engine == "arena" || Engine == "sets" || Engine == "reduce" ||
+           Engine == "weighted" || Engine == "exact";
+}
+
+static void usage(const char *Argv0) {
+    fprintf(stderr, "usage: %s [-paths N] [-candidates N] [-length N] "
+            "[-overlap P] [-hot P] [-zipf S] [-seed N] [-exact-budget-ms N] "
+            "[-run map,heap,bitset,arena,sets,reduce,weighted,exact]\n",
+            Argv0);
+}
+
+int main(int argc, char **argv) {
+    ShapeTy Shape = { 100000, 20000, 16, 1, 0.75, 0, 1.0 };
+    unsigned BudgetMS = 1000;
+    std::string Engines = "heap,bitset,arena,sets,reduce,weighted,exact";
+    for (int i = 1; i < argc; i += 2) {
+        const char *Arg = argv[i];
+        if (i + 1 == argc) {
+            usage(argv[0]);
+            return 1;
+        }
+        const char *Val = argv[i + 1];
+        if (!strcmp(Arg, "-paths"))
+            Shape.Paths = atoi(Val);
+        else if (!strcmp(Arg, "-candidates"))
+            Shape.Candidates = atoi(Val);
+        else if (!strcmp(Arg, "-length"))
+            Shape.Length = atoi(Val);
+        else if (!strcmp(Arg, "-overlap"))
+            Shape.Overlap = atof(Val);
+        else if (!strcmp(Arg, "-hot"))
+            Shape.Hot = atof(Val);
+        else if (!strcmp(Arg, "-zipf"))
+            Shape.Zipf = atof(Val);
+        else if (!strcmp(Arg, "-seed"))
+            Shape.Seed = atoi(Val);
+        else if (!strcmp(Arg, "-exact-budget-ms"))
+            BudgetMS = atoi(Val);
+        else if (!strcmp(Arg, "-run"))
+            Engines = Val;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (!Shape.Paths || !Shape.Candidates || !Shape.Length ||
+        Shape.Overlap <= 0 || Shape.Hot < 0 || Shape.Hot > 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    PathsTy Paths;
+    generate(Shape, Paths);
+    size_t Incidences = 0;
+    for (unsigned i = 0, e = Paths.size(); i != e; ++i)
+        Incidences += Paths[i].size();
+    printf("%u paths, %u candidates, %zu incidences (length %u, overlap %g, "
+           "hot %g, zipf %g, seed %u), popcount kernel %s\n", Shape.Paths,
+           Shape.Candidates, Incidences, Shape.Length, Shape.Overlap,
+           Shape.Hot, Shape.Zipf, Shape.Seed,
+           BitsetHittingSet::getKernelName());
+    printf("  %-8s %10s %10s %8s\n", "engine", "ms", "peak KB", "cuts");
+
+    bool HaveGreedy = false, Failed = false;
+    uint64_t GreedyHash = 0;
+    for (size_t Pos = 0; Pos <= Engines.size(); ) {
+        size_t Comma = Engines.find(',', Pos);
+        if (Comma == std::string::npos)
+            Comma = Engines.size();
+        std::string Engine = Engines.substr(Pos, Comma - Pos);
+        Pos = Comma + 1;
+        if (!isEngine(Engine)) {
+            fprintf(stderr, "unknown engine '%s'\n", Engine.c_str());
+            return 1;
+        }
+
+        ResultTy Result;
+        if (!runInChild(Engine, Shape, BudgetMS, Paths, Result)) {
+            printf("  %-8s failed\n", Engine.c_str());
+            Failed = true;
+            continue;
+        }
+        printf("  %-8s %10.2f %10ld %8u", Engine.c_str(), Result.MS,
+               Result.PeakKB, Result.Cuts);
+        if (Engine == "exact")
+            printf("  lower bound %u%s", Result.LowerBound,
+                   Result.Optimal ? ", optimal" : "");
+        printf("\n");
+
+        if (Engine == "heap" || Engine == "bitset" || Engine == "arena") {
+            if (HaveGreedy && Result.Hash != GreedyHash) {
+                printf("%s picks different cuts\n", Engine.c_str());
+                Failed = true;
+            }
+            HaveGreedy = true;
+            GreedyHash = Result.Hash;
+        }
+    }
+    return Failed ? 1 : 0;
+}
@@ -0,0 +1,267 @@
+//===-- mergeProfiles.cpp - Merge weighted profile runs -------------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Merges the profiles of any number of runs into one IdemProfile.h file, each
+// input scaled by the weight given before it:
+//
+//   mergeProfiles [-o merged.idemprof] [-llvmprof out] [-w weight] input...
+//
+// An input is recognized by its contents as one of:
+//
+//   - an IdemProfile.h file, e.g. an earlier merge, whose runs are all added
+//   - an llvmprof.out of -insert-edge-profiling; every edge count record in
+//     it is one run (the runtime appends a record per run)
+//   - LAMP dependence counts as text, one "load store count" line per
+//     dependence with instructions named by their -lamp-insts ids (blank
+//     lines and lines starting with '#' are skipped)
+//
+// With -llvmprof the merged edge counts are also written as an llvmprof.out
+// of a single run, rounded to whole counts, which -profile-loader reads as
+// it is.  For instance, to profile a training set:
+//
+//   for input in train/*; do
+//       rm -f llvmprof.out; ./prog.profile $input; mv llvmprof.out $input.prof
+//   done
+//   mergeProfiles -o train.idemprof -llvmprof llvmprof.out train/*.prof
+//
+//===----------------------------------------------------------------------===//
+
+#include "IdemProfile.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace llvm;
+
+// Record types of llvmprof.out (ProfileInfoTypes.h).
+enum { ArgumentInfo = 1, FunctionInfo = 2, BlockInfo = 3, EdgeInfo = 4 };
+
+static const uint32_t Uncounted = ~0U;
+
+struct Merged {
+    unsigned NumRuns;
+    double TotalWeight;
+    std::vector<double> Edges;                              // -1 = missing
+    std::map<std::pair<uint32_t, uint32_t>, double> Deps;
+
+    Merged() : NumRuns(0), TotalWeight(0) {}
+
+    void addEdge(size_t i, double Count) {
+        if (Edges.size() <= i)
+            Edges.resize(i + 1, -1);
+        Edges[i] = (Edges[i] < 0 ? 0 : Edges[i]) + Count;
+    }
+};
+
+static bool readFile(const char *Path, std::vector<char> &Data) {
+    FILE *In = fopen(Path, "rb");
+    if (!In)
+        return false;
+    char Buf[1 << 16];
+    size_t N;
+    while ((N = fread(Buf, 1, sizeof(Buf), In)) != 0)
+        Data.insert(Data.end(), Buf, Buf + N);
+    bool OK = !ferror(In);
+    fclose(In);
+    return OK;
+}
+
+static bool isLLVMProf(const std::vector<char> &Data) {
+    uint32_t Type;
+    if (Data.size() < 8 || Data.size() % 4)
+        return false;
+    memcpy(&Type, &Data[0], 4);
+    return Type >= ArgumentInfo && Type <= EdgeInfo;
+}
+
+static bool addIdemProfile(const std::vector<char> &Data, double Weight,
+                           Merged &M, std::string &Error) {
+    // Copy to 8-byte aligned memory for the view.
+    std::vector<uint64_t> Aligned(Data.size() / 8 + 1);
+    memcpy(&Aligned[0], &Data[0], Data.size());
+    IdemProfile P;
+    if (!P.init(&Aligned[0], Data.size(), Error))
+        return false;
+    for (size_t i = 0, e = P.getNumEdges(); i != e; ++i)
+        if (P.getEdgeCounts()[i] >= 0)
+            M.addEdge(i, Weight * P.getEdgeCounts()[i]);
+    for (size_t i = 0, e = P.getNumDeps(); i != e; ++i) {
+        const DepCountRecord &D = P.getDeps()[i];
+        M.Deps[std::make_pair(D.Load, D.Store)] += Weight * D.Count;
+    }
+    M.NumRuns += P.getNumRuns();
+    M.TotalWeight += Weight * P.getTotalWeight();
+    return true;
+}
+
+static bool addLLVMProf(const std::vector<char> &Data, double Weight,
+                        Merged &M, std::string &Error) {
+    const uint32_t *Words = reinterpret_cast<const uint32_t *>(&Data[0]);
+    size_t NumWords = Data.size() / 4, i = 0;
+    while (i + 2 <= NumWords) {
+        uint32_t Type = Words[i], N = Words[i + 1];
+        i += 2;
+        // The command line of the run, padded to a word.
+        size_t Len = Type == ArgumentInfo ? (N + 3) / 4 : N;
+        if (Len > NumWords - i) {
+            Error = "truncated llvmprof.out record";
+            return false;
+        }
+        if (Type == EdgeInfo) {
+            for (uint32_t e = 0; e != N; ++e)
+                if (Words[i + e] != Uncounted)
+                    M.addEdge(e, Weight * Words[i + e]);
+            ++M.NumRuns;
+            M.TotalWeight += Weight;
+        } else if (Type != ArgumentInfo && Type != FunctionInfo &&
+                   Type != BlockInfo) {
+            Error = "unsupported llvmprof.out record type";
+            return false;
+        }
+        i += Len;
+    }
+    if (i != NumWords) {
+        Error = "truncated llvmprof.out record";
+        return false;
+    }
+    return true;
+}
+
+static bool addLAMPText(const std::vector<char> &Data, double Weight,
+                        Merged &M, std::string &Error) {
+    std::string Text(Data.begin(), Data.end());
+    unsigned LineNo = 0;
+    for (size_t Pos = 0; Pos < Text.size(); ) {
+        size_t End = Text.find('\n', Pos);
+        if (End == std::string::npos)
+            End = Text.size();
+        std::string Line = Text.substr(Pos, End - Pos);
+        Pos = End + 1;
+        ++LineNo;
+        size_t First = Line.find_first_not_of(" \t\r");
+        if (First == std::string::npos || Line[First] == '#')
+            continue;
+        unsigned long Load, Store;
+        double Count;
+        char Extra;
+        if (sscanf(Line.c_str(), "%lu %lu %lf %c", &Load, &Store, &Count,
+                   &Extra) != 3 || Load > Uncounted || Store > Uncounted ||
+            Count < 0) {
+            char Buf[64];
+            snprintf(Buf, sizeof(Buf), "line %u: expected load store count",
+                     LineNo);
+            Error = Buf;
+            return false;
+        }
+        M.Deps[std::make_pair((uint32_t)Load, (uint32_t)Store)] +=
+            Weight * Count;
+    }
+    ++M.NumRuns;
+    M.TotalWeight += Weight;
+    return true;
+}
+
+// The edge counts as an llvmprof.out of one run.
+static bool writeLLVMProf(const char *Path, const std::vector<double> &Edges) {
+    std::vector<uint32_t> Words;
+    Words.push_back(EdgeInfo);
+    Words.push_back(Edges.size());
+    for (size_t i = 0, e = Edges.size(); i != e; ++i) {
+        if (Edges[i] < 0)
+            Words.push_back(Uncounted);
+        else if (Edges[i] >= Uncounted - 1.0)
+            Words.push_back(Uncounted - 1);
+        else
+            Words.push_back((uint32_t)floor(Edges[i] + 0.5));
+    }
+    FILE *Out = fopen(Path, "wb");
+    if (!Out)
+        return false;
+    bool OK = fwrite(&Words[0], 4, Words.size(), Out) == Words.size();
+    return fclose(Out) == 0 && OK;
+}
+
+static void usage(const char *Argv0) {
+    fprintf(stderr, "usage: %s [-o out.idemprof] [-llvmprof out] "
+            "[-w weight] input...\n", Argv0);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    const char *OutPath = "merged.idemprof", *LLVMProfPath = 0;
+    double Weight = 1;
+    unsigned NumInputs = 0;
+    Merged M;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            OutPath = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "-llvmprof") && i + 1 < argc) {
+            LLVMProfPath = argv[++i];
+            continue;
+        }
+        if (!strcmp(argv[i], "-w") && i + 1 < argc) {
+            char *End;
+            Weight = strtod(argv[++i], &End);
+            if (*End || !(Weight >= 0))
+                usage(argv[0]);
+            continue;
+        }
+        if (argv[i][0] == '-')
+            usage(argv[0]);
+
+        std::vector<char> Data;
+        if (!readFile(argv[i], Data)) {
+            perror(argv[i]);
+            return 1;
+        }
+        std::string Error;
+        bool OK;
+        if (Data.size() >= 8 && !memcmp(&Data[0], "IDEMPROF", 8))
+            OK = addIdemProfile(Data, Weight, M, Error);
+        else if (isLLVMProf(Data))
+            OK = addLLVMProf(Data, Weight, M, Error);
+        else
+            OK = addLAMPText(Data, Weight, M, Error);
+        if (!OK) {
+            fprintf(stderr, "%s: %s\n", argv[i], Error.c_str());
+            return 1;
+        }
+        ++NumInputs;
+    }
+    if (!NumInputs)
+        usage(argv[0]);
+
+    std::vector<DepCountRecord> Deps;
+    for (std::map<std::pair<uint32_t, uint32_t>, double>::iterator
+         I = M.Deps.begin(), E = M.Deps.end(); I != E; ++I) {
+        DepCountRecord D = { I->first.first, I->first.second, I->second };
+        Deps.push_back(D);
+    }
+    std::string Error;
+    if (!IdemProfile::write(OutPath, M.NumRuns, M.TotalWeight, M.Edges, Deps,
+                            Error)) {
+        fprintf(stderr, "%s\n", Error.c_str());
+        return 1;
+    }
+    if (LLVMProfPath && !writeLLVMProf(LLVMProfPath, M.Edges)) {
+        perror(LLVMProfPath);
+        return 1;
+    }
+    fprintf(stderr, "%u inputs, %u runs (weight %g): %zu edges, %zu "
+            "dependences\n", NumInputs, M.NumRuns, M.TotalWeight,
+            M.Edges.size(), Deps.size());
+    return 0;
+}